@@ -1,26 +1,154 @@
 #pragma once
 #include "executor.hpp"
 #include "program.hpp"
+#include "tape.hpp"
+#include <stdexcept>
 #include <string>
 #include <vector>
 
 namespace day25 {
-    /**
-     * Executes \ref Program "Programs" directly.
-     * \ingroup execution
-     */
-class AstExecutor : public virtual Executor {
+/**
+ * A linked \ref Program, as run by \ref AstExecutor.
+ * \ingroup execution
+ */
+class AstProgram : public CompiledProgram {
+  public:
+    AstProgram(Program program);
+    virtual std::shared_ptr<Executor>
+    instantiate(const ExecutorOptions &options = ExecutorOptions()) const;
+};
+
+/**
+ * Executes \ref Program "Programs" directly, on a tape of type `TapeT`
+ * (see \ref BasicTape), reporting each step to an observer of type
+ * `ObserverT` (see \ref NullObserver).
+ * \ingroup execution
+ */
+template <class TapeT, class ObserverT = NullObserver>
+class BasicAstExecutor : public virtual Executor {
   public:
-    AstExecutor(Program program);
-    virtual ~AstExecutor();
-    virtual void step();
-    virtual void reset();
-    virtual uint32_t diagnostic_checksum();
+    BasicAstExecutor(Program program,
+                     const ExecutorOptions &options = ExecutorOptions(),
+                     ObserverT observer = ObserverT())
+        : BasicAstExecutor(std::make_shared<AstProgram>(program), options,
+                           observer) {}
+    BasicAstExecutor(std::shared_ptr<const AstProgram> compiled,
+                     const ExecutorOptions &options = ExecutorOptions(),
+                     ObserverT observer = ObserverT())
+        : m_compiled(compiled),
+          m_memory(compiled->program().checksum_delay, options.tape_file,
+                   options.tape_advice,
+                   options.pages),
+          m_offset(m_memory.origin()),
+          m_state(compiled->program().initial_state_link),
+          m_observer(observer), m_stop(options.stop), m_stop_state(nullptr) {
+        if (m_stop.conditions().has_state()) {
+            auto &states = compiled->program().states;
+            auto it = states.find(options.stop.state);
+            if (it == states.end()) {
+                throw std::runtime_error("Unknown stop state " +
+                                         options.stop.state);
+            }
+            m_stop_state = &it->second;
+        }
+        m_stop.start(0);
+    }
+    virtual ~BasicAstExecutor() {}
+
+    virtual void step() {
+        if (m_stop.active()) {
+            advance<true>();
+        } else {
+            advance<false>();
+        }
+    }
+    virtual void run(uint64_t steps) {
+        m_stop_event = StopEvent();
+        if (!m_stop.active()) {
+            for (uint64_t i = 0; i < steps; i++) {
+                advance<false>();
+            }
+            return;
+        }
+        m_stop_event =
+            m_stop.run(steps, m_steps, [this] { return advance<true>(); });
+    }
+    virtual void reset() {
+        m_memory.clear();
+        m_offset = m_memory.origin();
+        m_state = m_compiled->program().initial_state_link;
+        m_steps = 0;
+        m_stop.start(0);
+    }
+    virtual uint64_t diagnostic_checksum() { return m_memory.checksum(); }
+    virtual uint64_t head() const { return m_offset; }
+    virtual uint64_t tape_size() const { return m_memory.size(); }
+    virtual MemoryUsage memory_usage(bool measure_touched = true) const {
+        auto usage = m_compiled->memory_usage();
+        add_tape_usage(usage, m_memory, measure_touched);
+        return usage;
+    }
+    virtual std::string state() const { return m_state->name; }
+    virtual MachineState machine_state() const {
+        return MachineState{
+            .tape = m_memory.contents(),
+            .head = m_offset,
+            .state = m_state->name,
+            .steps = m_steps,
+        };
+    }
+    virtual void restore_machine_state(const MachineState &state) {
+        auto it = m_compiled->program().states.find(state.state);
+        if (it == m_compiled->program().states.end()) {
+            throw std::runtime_error("Checkpoint does not match program.");
+        }
+        m_memory.assign(state.tape);
+        m_offset = state.head;
+        m_state = &it->second;
+        m_steps = state.steps;
+        m_stop.start(m_stop.conditions().has_checksum_limit()
+                         ? m_memory.checksum()
+                         : 0);
+    }
 
   protected:
-    const Program m_program;
-    std::vector<char> m_memory;
-    uint32_t m_offset;
-    std::string m_state;
+    /** Run one step. With `Stop`, also check the stop conditions, and
+     * return the one that holds.
+     */
+    template <bool Stop> StopReason advance() {
+        auto slot = m_memory.get(m_offset);
+        const auto &action = *m_state->action_links[slot];
+        m_observer.write(m_offset, slot, action.write_value);
+        m_observer.move(m_offset, action.move_direction);
+        m_observer.transition(m_state->name, action.next_state);
+        m_memory.set(m_offset, action.write_value);
+        m_offset = m_memory.move(m_offset, action.move_direction);
+        m_state = action.next_state_link;
+        m_steps++;
+        if constexpr (Stop) {
+            return m_stop.after_step(slot, action.write_value,
+                                     action.move_direction,
+                                     m_state == m_stop_state);
+        } else {
+            return StopReason::NONE;
+        }
+    }
+
+    //! \ref m_state points into this.
+    std::shared_ptr<const AstProgram> m_compiled;
+    TapeT m_memory;
+    uint64_t m_offset;
+    const State *m_state;
+    ObserverT m_observer;
+    StopTracker m_stop;
+    //! The stop state, or nullptr.
+    const State *m_stop_state;
 };
-} // namespace day25
\ No newline at end of file
+
+/** \ref BasicAstExecutor on the default \ref Tape.
+ * \ingroup execution
+ */
+typedef BasicAstExecutor<Tape> AstExecutor;
+extern template class BasicAstExecutor<Tape>;
+extern template class BasicAstExecutor<Tape, ObserverRef>;
+} // namespace day25
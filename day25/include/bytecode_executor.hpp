@@ -1,30 +1,194 @@
 #pragma once
 #include "executor.hpp"
 #include "program.hpp"
+#include "tape.hpp"
+#include <map>
+#include <stdexcept>
+#include <vector>
 
 namespace day25 {
-    /** Converts \ref Program "Programs" into bytecode for faster execution.
-     * \ingroup execution
+/**
+ * The bytecode table for a \ref Program, as run by \ref BytecodeExecutor.
+ * \ingroup execution
+ */
+class BytecodeProgram : public CompiledProgram {
+  public:
+    BytecodeProgram(Program program);
+    virtual std::shared_ptr<Executor>
+    instantiate(const ExecutorOptions &options = ExecutorOptions()) const;
+    virtual MemoryUsage memory_usage() const;
+
+    //! One entry per state, holding the encoded actions for tape values 0 and 1.
+    const uint64_t *code() const { return m_code.data(); }
+    //! Index of the initial state.
+    uint32_t initial_state() const { return m_initial_state; }
+    /** Index of the state named `name`.
+     * \throws std::out_of_range If there is no such state.
      */
-class BytecodeExecutor : public virtual Executor {
+    uint32_t state_index(const std::string &name) const {
+        return m_state_map.at(name);
+    }
+    bool has_state(const std::string &name) const {
+        return m_state_map.count(name);
+    }
+    const std::string &state_name(uint32_t index) const {
+        return m_state_names[index];
+    }
+
+    static void decode_action(uint32_t encoded, uint8_t &write_contents,
+                              int8_t &move_direction, uint32_t &next_state) {
+        write_contents = encoded & 0x01;
+        move_direction = ((encoded >> 1) & 0x01) ? 1 : -1;
+        next_state = (encoded >> 2);
+    }
+
+  private:
+    std::map<std::string, uint32_t> m_state_map;
+    std::vector<std::string> m_state_names;
+    std::vector<uint64_t> m_code;
+    uint32_t m_initial_state;
+
+    uint64_t encode_state(const day25::State &state);
+    uint32_t encode_action(const day25::StateAction &action);
+};
+
+/** Converts \ref Program "Programs" into bytecode for faster execution,
+ * and runs it on a tape of type `TapeT` (see \ref BasicTape), reporting
+ * each step to an observer of type `ObserverT` (see \ref NullObserver).
+ * \ingroup execution
+ */
+template <class TapeT, class ObserverT = NullObserver>
+class BasicBytecodeExecutor : public virtual Executor {
   public:
-    BytecodeExecutor(Program program);
-    virtual ~BytecodeExecutor();
-    virtual void reset();
-    virtual void step();
-    virtual uint32_t diagnostic_checksum();
+    BasicBytecodeExecutor(Program program,
+                          const ExecutorOptions &options = ExecutorOptions(),
+                          ObserverT observer = ObserverT())
+        : BasicBytecodeExecutor(std::make_shared<BytecodeProgram>(program),
+                                options, observer) {}
+    BasicBytecodeExecutor(std::shared_ptr<const BytecodeProgram> compiled,
+                          const ExecutorOptions &options = ExecutorOptions(),
+                          ObserverT observer = ObserverT())
+        : m_compiled(compiled), m_code(compiled->code()),
+          m_tape(compiled->program().checksum_delay, options.tape_file,
+                 options.tape_advice,
+                 options.pages),
+          m_observer(observer), m_stop(options.stop), m_stop_state(UINT32_MAX) {
+        if (m_stop.conditions().has_state()) {
+            if (!compiled->has_state(options.stop.state)) {
+                throw std::runtime_error("Unknown stop state " +
+                                         options.stop.state);
+            }
+            m_stop_state = compiled->state_index(options.stop.state);
+        }
+        reset();
+    }
+    virtual ~BasicBytecodeExecutor() {}
+
+    virtual void reset() {
+        m_tape.clear();
+        m_state = m_compiled->initial_state();
+        m_memory_offset = m_tape.origin();
+        m_steps = 0;
+        m_stop.start(0);
+    }
+    virtual void step() {
+        if (m_stop.active()) {
+            advance<true>();
+        } else {
+            advance<false>();
+        }
+    }
+    virtual void run(uint64_t steps) {
+        m_stop_event = StopEvent();
+        if (!m_stop.active()) {
+            for (uint64_t i = 0; i < steps; i++) {
+                advance<false>();
+            }
+            return;
+        }
+        m_stop_event =
+            m_stop.run(steps, m_steps, [this] { return advance<true>(); });
+    }
+    virtual uint64_t diagnostic_checksum() { return m_tape.checksum(); }
+    virtual uint64_t head() const { return m_memory_offset; }
+    virtual uint64_t tape_size() const { return m_tape.size(); }
+    virtual MemoryUsage memory_usage(bool measure_touched = true) const {
+        auto usage = m_compiled->memory_usage();
+        add_tape_usage(usage, m_tape, measure_touched);
+        return usage;
+    }
+    virtual std::string state() const {
+        return m_compiled->state_name(m_state);
+    }
+    virtual MachineState machine_state() const {
+        return MachineState{
+            .tape = m_tape.contents(),
+            .head = m_memory_offset,
+            .state = m_compiled->state_name(m_state),
+            .steps = m_steps,
+        };
+    }
+    virtual void restore_machine_state(const MachineState &state) {
+        if (!m_compiled->has_state(state.state)) {
+            throw std::runtime_error("Checkpoint does not match program.");
+        }
+        m_tape.assign(state.tape);
+        m_memory_offset = state.head;
+        m_state = m_compiled->state_index(state.state);
+        m_steps = state.steps;
+        m_stop.start(m_stop.conditions().has_checksum_limit() ? m_tape.checksum()
+                                                     : 0);
+    }
 
   private:
-    const Program m_program;
-    std::map<std::string, uint8_t> m_state_map;
-    uint8_t m_state;
-    uint32_t m_memory_offset;
-    uint8_t *m_memory;
-    uint16_t *m_code;
-
-    uint16_t encode_state(const day25::State &state);
-    uint8_t encode_action(const day25::StateAction &action);
-    void decode_action(uint8_t &encoded, uint8_t &write_contents,
-                       int8_t &move_direction, uint8_t &next_state);
+    /** Run one step. With `Stop`, also check the stop conditions, and
+     * return the one that holds.
+     */
+    template <bool Stop> StopReason advance() {
+        auto bytecode = m_code[m_state];
+        auto slot = m_tape.get(m_memory_offset);
+        uint32_t encoded_action;
+        if (slot == 0) {
+            encoded_action = bytecode & 0xffffffff;
+        } else {
+            encoded_action = (bytecode >> 32) & 0xffffffff;
+        }
+        uint8_t write_contents;
+        int8_t move_direction;
+        uint32_t next_state;
+        BytecodeProgram::decode_action(encoded_action, write_contents,
+                                       move_direction, next_state);
+        m_observer.write(m_memory_offset, slot, write_contents);
+        m_observer.move(m_memory_offset, move_direction);
+        m_observer.transition(m_compiled->state_name(m_state),
+                              m_compiled->state_name(next_state));
+        m_tape.set(m_memory_offset, write_contents);
+        m_memory_offset = m_tape.move(m_memory_offset, move_direction);
+        m_state = next_state;
+        m_steps++;
+        if constexpr (Stop) {
+            return m_stop.after_step(slot, write_contents, move_direction,
+                                     next_state == m_stop_state);
+        } else {
+            return StopReason::NONE;
+        }
+    }
+
+    std::shared_ptr<const BytecodeProgram> m_compiled;
+    const uint64_t *m_code;
+    uint32_t m_state;
+    uint64_t m_memory_offset;
+    TapeT m_tape;
+    ObserverT m_observer;
+    StopTracker m_stop;
+    //! Index of the stop state, or UINT32_MAX.
+    uint32_t m_stop_state;
 };
-} // namespace day25
\ No newline at end of file
+
+/** \ref BasicBytecodeExecutor on the default \ref Tape.
+ * \ingroup execution
+ */
+typedef BasicBytecodeExecutor<Tape> BytecodeExecutor;
+extern template class BasicBytecodeExecutor<Tape>;
+extern template class BasicBytecodeExecutor<Tape, ObserverRef>;
+} // namespace day25
@@ -0,0 +1,51 @@
+#pragma once
+#include "program.hpp"
+#include <iostream>
+#include <string>
+
+namespace day25 {
+/**
+ * Settings for \ref generate_c_source and \ref generate_c_header.
+ * \ingroup codegen
+ */
+struct CGeneratorOptions {
+    //! Prefix of all names in the generated code; upper-cased for macros.
+    std::string prefix = "program";
+    //! Also emit a `main()` that benchmarks the program and prints its checksum.
+    bool benchmark_harness = true;
+};
+
+/** Write a C header declaring the interface of the code generated by \ref generate_c_source.
+ *
+ * With the default prefix, it declares:
+ * \code
+ * #define PROGRAM_TAPE_SIZE ...        // slots in the tape ring
+ * #define PROGRAM_CHECKSUM_DELAY ...   // steps until the checksum
+ * #define PROGRAM_STATE_COUNT ...
+ * #define PROGRAM_INITIAL_STATE ...
+ * extern const char *const program_state_names[PROGRAM_STATE_COUNT];
+ * void program_run(unsigned char *tape, unsigned long long steps,
+ *                  unsigned *state, unsigned long long *head);
+ * \endcode
+ * `program_run` continues the machine in `*state` at slot `*head` of `tape`, which has to hold
+ * `PROGRAM_TAPE_SIZE` slots, and updates both after `steps` steps.
+ * States are numbered in name order.
+ * \ingroup codegen
+ */
+void generate_c_header(std::ostream &os, const Program &program,
+                       const CGeneratorOptions &options = CGeneratorOptions());
+
+/** Write C code that runs `program`.
+ *
+ * Each state becomes a label, and transitions are direct `goto`s. The head is a pointer that
+ * only checks for wrapping around the tape in the direction it moves.
+ * \param os Stream to write the code to.
+ * \param program The program to translate.
+ * \param header_name File name of the header written by \ref generate_c_header, which the code includes.
+ * \param options Settings for the generator.
+ * \ingroup codegen
+ */
+void generate_c_source(std::ostream &os, const Program &program,
+                       const std::string &header_name,
+                       const CGeneratorOptions &options = CGeneratorOptions());
+} // namespace day25
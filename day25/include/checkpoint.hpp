@@ -0,0 +1,36 @@
+#pragma once
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace day25 {
+/**
+ * Snapshot of a running turing machine.
+ *
+ * The snapshot does not depend on the \ref Executor that created it, so a run
+ * can be continued with a different executor type.
+ * \ingroup execution
+ */
+struct MachineState {
+    //! Contents of the tape, one byte per slot.
+    std::vector<uint8_t> tape;
+    //! Index of the current tape slot.
+    uint64_t head;
+    //! Name of the current state.
+    std::string state;
+    //! Number of steps executed since the last reset.
+    uint64_t steps;
+};
+
+/** Write a \ref MachineState to `os`, run-length encoding the tape.
+ * \ingroup execution
+ */
+void write_checkpoint(std::ostream &os, const MachineState &state);
+
+/** Read a \ref MachineState written by \ref write_checkpoint.
+ * \throws std::runtime_error If the input is not a valid checkpoint.
+ * \ingroup execution
+ */
+MachineState read_checkpoint(std::istream &is);
+} // namespace day25
@@ -0,0 +1,95 @@
+#ifndef D25_H
+#define D25_H
+/**
+ * \file d25.h
+ * Stable C interface to the day25 library.
+ *
+ * Lets other languages and services parse and run programs in-process.
+ * All functions are safe to call from multiple threads as long as a single
+ * \ref d25_executor is not used by two threads at the same time.
+ *
+ * Functions that can fail take an `error` buffer of `error_size` bytes. On
+ * failure, a NUL-terminated message is written to it (if it is not NULL).
+ *
+ * Example:
+ * \code
+ * char error[256];
+ * d25_program *program = d25_program_parse(source, strlen(source), error, sizeof(error));
+ * d25_executor *executor = d25_executor_create(program, "jit", error, sizeof(error));
+ * d25_executor_run(executor, d25_program_checksum_delay(program), error, sizeof(error));
+ * printf("%llu\n", (unsigned long long)d25_executor_checksum(executor));
+ * d25_executor_destroy(executor);
+ * d25_program_destroy(program);
+ * \endcode
+ * \ingroup capi
+ */
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(__GNUC__)
+#define D25_API __attribute__((visibility("default")))
+#else
+#define D25_API
+#endif
+
+//! Incremented whenever the interface changes incompatibly.
+#define D25_API_VERSION 1
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//! A parsed program. Immutable, can be shared between executors.
+typedef struct d25_program d25_program;
+//! A running turing machine.
+typedef struct d25_executor d25_executor;
+
+//! Return \ref D25_API_VERSION as compiled into the library.
+D25_API int d25_api_version(void);
+
+/** Parse a program from `length` bytes at `source`.
+ * \return The program, or NULL on error.
+ */
+D25_API d25_program *d25_program_parse(const char *source, size_t length,
+                                       char *error, size_t error_size);
+//! Number of steps after which the program wants its checksum calculated.
+D25_API uint64_t d25_program_checksum_delay(const d25_program *program);
+D25_API void d25_program_destroy(d25_program *program);
+
+//! Number of available executor types.
+D25_API size_t d25_executor_type_count(void);
+//! Name of the executor type at `index`, or NULL if out of range.
+D25_API const char *d25_executor_type_name(size_t index);
+
+/** Create an executor of type `type` for `program`.
+ *
+ * The program is not referenced after this call returns.
+ * \return The executor, or NULL on error.
+ */
+D25_API d25_executor *d25_executor_create(const d25_program *program,
+                                          const char *type, char *error,
+                                          size_t error_size);
+/** Execute `steps` steps.
+ * \return 0 on success, -1 on error.
+ */
+D25_API int d25_executor_run(d25_executor *executor, uint64_t steps,
+                             char *error, size_t error_size);
+//! Calculate the diagnostic checksum of the tape.
+D25_API uint64_t d25_executor_checksum(d25_executor *executor);
+//! Index of the current tape slot.
+D25_API uint64_t d25_executor_head(const d25_executor *executor);
+/** Name of the current state.
+ *
+ * The string stays valid until the next call on this executor.
+ */
+D25_API const char *d25_executor_state(d25_executor *executor);
+//! Steps executed since creation or the last reset.
+D25_API uint64_t d25_executor_steps(const d25_executor *executor);
+//! Reset tape, head and state to the initial configuration.
+D25_API void d25_executor_reset(d25_executor *executor);
+D25_API void d25_executor_destroy(d25_executor *executor);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
+#endif
@@ -17,6 +17,8 @@
  * \defgroup parsing Parsing
  * \defgroup execution Execution
  * \defgroup jit JIT Machine Code Generation
+ * \defgroup codegen C Code Generation
+ * \defgroup capi C API
  */
 
 namespace day25 {
@@ -27,4 +29,22 @@ namespace day25 {
      * \ingroup parsing
      */
 Program load_file(const std::string &filename);
+
+    /**
+     * Construct a \ref Program from a string containing the program source.
+     * \throws std::runtime_error If any error occurs during tokenization or parsing.
+     * \related Program
+     * \ingroup parsing
+     */
+Program load_string(const std::string &source);
+
+    /**
+     * Construct a \ref Program from a stream.
+     * \param source Stream to read the program source from.
+     * \param name Name of the source, used in error messages.
+     * \throws std::runtime_error If any error occurs during tokenization or parsing.
+     * \related Program
+     * \ingroup parsing
+     */
+Program parse_program(std::istream &source, const std::string &name);
 }
\ No newline at end of file
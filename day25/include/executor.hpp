@@ -1,11 +1,40 @@
 #pragma once
+#include "checkpoint.hpp"
+#include "memory_usage.hpp"
+#include "observer.hpp"
+#include "program.hpp"
+#include "run_handle.hpp"
+#include "stop_conditions.hpp"
+#include "tape_memory.hpp"
 #include <cstdint>
+#include <functional>
 #include <list>
 #include <memory>
 #include <string>
 
 namespace day25 {
-struct Program;
+/**
+ * Settings shared by all executor types.
+ * \ingroup execution
+ */
+struct ExecutorOptions {
+    //! If non-empty, back the tape with this (sparse) file instead of RAM.
+    std::string tape_file;
+    //! Access pattern hint for the tape memory.
+    TapeAdvice tape_advice = TapeAdvice::NORMAL;
+    //! Page size and NUMA placement of the tape memory.
+    PagePolicy pages;
+    /** Called for every step, if set. Only the `ast`, `bytecode` and `jit*`
+     * executors support observers; the JIT ones only for programs compiled
+     * with \ref CompileOptions::observed.
+     */
+    Observer *observer = nullptr;
+    /** End runs early when one of these holds. Only the `ast`, `bytecode`
+     * and `jit*` executors support stop conditions; the JIT ones only those
+     * they were compiled for, see \ref CompileOptions::stop.
+     */
+    StopConditions stop;
+};
 
 /**
  * Base class for everything that can run a \ref Program.
@@ -16,23 +45,165 @@ class Executor {
     virtual ~Executor() {}
     //! Execute a single calculation step (one \ref StateAction).
     virtual void step() = 0;
+    //! Execute `steps` calculation steps.
+    virtual void run(uint64_t steps) {
+        for (uint64_t i = 0; i < steps; i++) {
+            step();
+        }
+    }
+    /** Execute `steps` calculation steps on a worker thread.
+     *
+     * The run stops early when cancelled through the returned handle, when
+     * `options.deadline` has passed, or when a stop condition holds. Both are checked every
+     * `options.check_interval` steps, by calling \ref run with at most that
+     * many steps at a time.
+     *
+     * \warning
+     * The executor must outlive the run, and must not be used otherwise until
+     * \ref RunHandle::done returns true.
+     */
+    RunHandle run_async(uint64_t steps, const RunOptions &options = RunOptions());
     //! Reset the turing machine to its initial state.
     virtual void reset() = 0;
     //! Calculate the diagnostic checksum for the tape.
-    virtual uint32_t diagnostic_checksum() = 0;
+    virtual uint64_t diagnostic_checksum() = 0;
+
+    //! Number of steps executed since construction or the last \ref reset.
+    uint64_t steps_executed() const { return m_steps; }
+    //! Which of \ref ExecutorOptions::stop ended the last \ref run early, if any.
+    StopEvent stop_event() const { return m_stop_event; }
+    //! Index of the current tape slot.
+    virtual uint64_t head() const = 0;
+    //! Number of tape slots currently allocated, i.e. the extent of the tape the head visited.
+    virtual uint64_t tape_size() const = 0;
+    /** Memory held by this executor's tape and by the compiled program it runs.
+     * \param measure_touched Also fill in \ref MemoryUsage::tape_touched,
+     *                        which may have to ask the kernel about every page.
+     */
+    virtual MemoryUsage memory_usage(bool measure_touched = true) const = 0;
+    //! Name of the current state.
+    virtual std::string state() const = 0;
+
+    //! Take a snapshot of tape, head, current state and step count.
+    virtual MachineState machine_state() const = 0;
+    /** Continue from a snapshot taken by any executor for the same program.
+     * \throws std::runtime_error If the snapshot does not fit the program.
+     */
+    virtual void restore_machine_state(const MachineState &state) = 0;
+
+    //! Write a checkpoint of the current machine state to `filename`.
+    void save_checkpoint(const std::string &filename) const;
+    /** Write a previously taken snapshot to `filename`.
+     *
+     * Taking the snapshot is cheap compared to compressing and writing it, so
+     * this can be called from a background thread while the executor keeps
+     * running.
+     */
+    static void save_checkpoint(const std::string &filename,
+                                const MachineState &state);
+    //! Restore the machine state from a checkpoint written by \ref save_checkpoint.
+    void load_checkpoint(const std::string &filename);
+
+  protected:
+    uint64_t m_steps = 0;
+    StopEvent m_stop_event;
+};
+
+/**
+ * A \ref Program translated for one executor type.
+ *
+ * Translating happens once, in \ref compile_program. The result does not
+ * change afterwards (except through \ref JitProgram::patch_states, which the
+ * caller must keep apart from all runs) and may be shared between threads. Executors created by
+ * \ref instantiate only own their tape, head and current state, so creating
+ * many executors for the same program is cheap.
+ * \ingroup execution
+ */
+class CompiledProgram : public std::enable_shared_from_this<CompiledProgram> {
+  public:
+    virtual ~CompiledProgram() {}
+    //! The linked program this was compiled from.
+    const Program &program() const { return m_program; }
+    //! Create an executor for this program, starting in its initial state.
+    virtual std::shared_ptr<Executor>
+    instantiate(const ExecutorOptions &options = ExecutorOptions()) const = 0;
+    //! Memory held by code and tables, shared by all instantiated executors.
+    virtual MemoryUsage memory_usage() const { return MemoryUsage(); }
+
+  protected:
+    CompiledProgram(Program program);
+    /** The program, for compiled programs that can change it after compiling,
+     * like \ref JitProgram::patch_states.
+     */
+    Program &mutable_program() { return m_program; }
+
+  private:
+    Program m_program;
 };
 
+/**
+ * Settings for translating a program, shared by all executor types.
+ * \ingroup execution
+ */
+struct CompileOptions {
+    //! Page size and NUMA placement of generated machine code.
+    PagePolicy pages;
+    /** Generate code that calls \ref ExecutorOptions::observer. Without it,
+     * no code to call observers is generated at all.
+     */
+    bool observed = false;
+    /** Stop conditions to generate code for. Executors of the program must
+     * use the same \ref ExecutorOptions::stop.
+     */
+    StopConditions stop;
+};
+
+//! Translates a \ref Program for one executor type.
+typedef std::function<std::shared_ptr<const CompiledProgram>(
+    Program, const CompileOptions &)>
+    ProgramCompiler;
+
+/** Add an executor type, or replace the one named `type`.
+ *
+ * Call this before starting any threads that use \ref compile_program, e.g.
+ * from a static initializer.
+ * \ingroup execution
+ */
+void register_executor(const std::string &type, ProgramCompiler compiler);
+
 /** Return the names of all known executor types.
+ *
+ * \param include_variants Also return the `ast` and `bytecode` executors for
+ *        every combination of tape policies (see \ref BasicTape), named
+ *        `<executor>:<cells>:<storage>:<boundary>`, e.g.
+ *        `bytecode:bit:chunked:growable`.
  * \ingroup execution
  */
-std::list<std::string> list_executors();
+std::list<std::string> list_executors(bool include_variants = false);
 
 /** Create a new executor.
  *
  * \param type Type-name of the executor. Must be one of the values returned by \ref list_executors.
  * \param p The program to execute.
+ * \param options Settings for the executor. Its page policy applies to
+ *                generated code, too, which calls its observer if set.
  * \relates Executor
  * \ingroup execution
 */
-std::shared_ptr<Executor> get_executor(const std::string &type, Program p);
+std::shared_ptr<Executor>
+get_executor(const std::string &type, Program p,
+             const ExecutorOptions &options = ExecutorOptions());
+
+/** Translate a program once for executor type `type`.
+ *
+ * Use \ref CompiledProgram::instantiate to create executors for it.
+ * \param type Type-name of the executor. Must be one of the values returned by \ref list_executors.
+ * \param p The program to compile.
+ * \param options Settings for the translation.
+ * \relates CompiledProgram
+ * \ingroup execution
+ */
+std::shared_ptr<const CompiledProgram>
+compile_program(const std::string &type, Program p,
+                const CompileOptions &options = CompileOptions());
 } // namespace day25
\ No newline at end of file
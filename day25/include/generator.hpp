@@ -0,0 +1,35 @@
+#pragma once
+#include "program.hpp"
+#include <cstdint>
+#include <iostream>
+
+namespace day25 {
+/**
+ * Knobs for \ref generate_program.
+ * \ingroup parsing
+ */
+struct GeneratorOptions {
+    //! Number of states in the generated machine.
+    uint32_t states = 6;
+    //! Number of steps before the checksum is calculated.
+    uint64_t steps = 12000000;
+    //! Probability that an action moves the head to the right.
+    double right_bias = 0.5;
+    //! Seed for the random number generator. Equal seeds yield equal programs.
+    uint64_t seed = 1;
+};
+
+/** Create a random \ref Program.
+ *
+ * Every state gets one action per tape value, with random write value,
+ * direction (according to \ref GeneratorOptions::right_bias) and successor
+ * state. The result only depends on `options`, so runs are reproducible.
+ * \ingroup parsing
+ */
+Program generate_program(const GeneratorOptions &options);
+
+/** Write `program` in the same format that \ref load_file reads.
+ * \ingroup parsing
+ */
+void write_program(std::ostream &os, const Program &program);
+} // namespace day25
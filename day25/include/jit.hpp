@@ -1,7 +1,11 @@
 #pragma once
+#include "jit_debug.hpp"
+#include "page_allocator.hpp"
+#include <memory>
 #include <iostream>
 #include <list>
 #include <map>
+#include <set>
 #include <stdexcept>
 #include <string>
 #include <vector>
@@ -113,12 +117,26 @@ struct Symbol {
  */
 class Jit {
   public:
-    Jit();
+    /** Create a code generator with a buffer of `code_size` bytes for
+     * instructions, allocated according to `pages`.
+     */
+    Jit(uint32_t code_size = 16384, const PagePolicy &pages = PagePolicy());
     ~Jit();
 
     // Requirements to actually execute code:
-    //! Mark the code buffer as executable and resolve all symbols used in instructions.
+    /** Mark the code buffer as executable and resolve all symbols used in instructions.
+     *
+     * After \ref reopen_code, only references emitted or pointing to symbols
+     * redefined since then are resolved again. Publishes \ref code_symbols to
+     * the tools selected with \ref set_jit_debug_info.
+     */
     void finalize_code();
+    /** Make finalized code writable again, to emit more code or patch it.
+     *
+     * The buffer is never writable and executable at the same time: until the
+     * next \ref finalize_code, no thread may run any of the code.
+     */
+    void reopen_code();
     //! Call the function at offset 0 in the buffer, passing `arg` as the first argument.
     uint64_t call(uint64_t arg);
     //! Call the function at symbol with name `entrypoint`, passing `arg` as the first argument.
@@ -129,6 +147,17 @@ class Jit {
     void emit_symbol(const std::string &name);
     //! Mark the location `location` with the name `name`. `location` may refer to memory outside of the buffer.
     void emit_symbol(const std::string &name, void *location);
+    /** Remove the symbol `name`, so it can be defined again.
+     *
+     * References to it are updated to the new definition by the next \ref finalize_code.
+     */
+    void undefine_symbol(const std::string &name);
+    /** Overwrite the 5 bytes at `location` with a near jump to `target`.
+     *
+     * Used to redirect code that still falls through into, or has stored the address of,
+     * code that was replaced. Needs writable code, see \ref reopen_code.
+     */
+    void patch_jmp(const Symbol &location, const Symbol &target);
 
     // Mark the current location to be replaced by a symbol pointer later on:
     //! Replace the uint64 starting at the current offset with the address of the symbol `name` during finalization.
@@ -148,6 +177,8 @@ class Jit {
      * Ensure to call this with the correct type when trying to write single bytes!
      **/
     template <class T> void emit(const T &v) { emit(sizeof(T), &v); }
+    //! Pad with `int3` instructions until the current location is a multiple of `alignment` bytes.
+    void emit_align(uint32_t alignment);
 
     // Generate common instructions:
     //! Write a `ret` (return) instruction.
@@ -248,22 +279,48 @@ class Jit {
 
     // Utility and inspection:
     std::vector<uint8_t> dump_memory() const;
+    //! Size of the code buffer, as passed to the constructor.
+    uint32_t code_size() const { return m_code_size; }
+    //! Bytes mapped for the code buffer, at least \ref code_size.
+    uint64_t mapped_size() const { return m_mapped_size; }
+    //! Bytes of the code buffer that hold instructions.
+    uint32_t code_used() const { return m_offset; }
+    //! Bytes allocated by \ref add_constant and \ref add_buffer.
+    uint64_t data_size() const;
 
     //! Return an object that can be used to refer to symbols.
     Symbol symbol(const std::string &name) const;
+    /** The symbols defined in the code buffer, ordered by address, each
+     * extending to the next one.
+     *
+     * Of several symbols at the same address, only the first by name is
+     * listed, preferring names not starting with `_`.
+     */
+    std::vector<JitCodeSymbol> code_symbols() const;
 
   private:
     struct SymbolRef;
     struct Buffer;
     uint32_t m_code_size;
+    uint64_t m_mapped_size;
     uint32_t m_offset;
     bool m_code_finalized;
     uint8_t *m_code;
     std::map<std::string, Buffer> m_buffers;
     std::map<std::string, void *> m_symbols;
-    std::list<SymbolRef> m_symbol_refs;
+    //! All references, by the offset of the bytes to replace.
+    std::map<uint32_t, SymbolRef> m_symbol_refs;
+    //! Offsets of the references to each symbol, as in \ref m_symbol_refs.
+    std::map<std::string, std::set<uint32_t>> m_refs_to;
+    //! References \ref finalize_code still has to resolve.
+    std::vector<uint32_t> m_unresolved_refs;
+    std::unique_ptr<JitDebugEntry> m_debug_entry;
 
     uint64_t call(void *location, uint64_t arg);
+    void add_symbol_ref(const SymbolRef &ref);
+    //! Remove `ref` from \ref m_symbol_refs and \ref m_refs_to.
+    std::map<uint32_t, SymbolRef>::iterator
+    erase_symbol_ref(std::map<uint32_t, SymbolRef>::iterator ref);
 };
 
 struct Jit::SymbolRef {
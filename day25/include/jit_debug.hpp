@@ -0,0 +1,71 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <set>
+#include <string>
+#include <tuple>
+#include <vector>
+
+namespace day25 {
+/** Which tools to tell about generated code, see \ref set_jit_debug_info.
+ * \ingroup jit
+ */
+enum JitDebugInfo : unsigned {
+    JIT_DEBUG_NONE = 0,
+    /** Append the symbols of generated code to `/tmp/perf-<pid>.map`, where
+     * `perf report` looks for symbols of anonymous executable memory.
+     */
+    JIT_DEBUG_PERF_MAP = 1,
+    /** Register the symbols of generated code with GDB's JIT interface, so
+     * it can show them in backtraces, and disassemble or break on them.
+     */
+    JIT_DEBUG_GDB = 2,
+};
+
+/** Select which tools to tell about code that is finalized from now on, as a
+ * combination of \ref JitDebugInfo flags. Off by default.
+ * \ingroup jit
+ */
+void set_jit_debug_info(unsigned flags);
+
+/** The flags set by \ref set_jit_debug_info.
+ * \ingroup jit
+ */
+unsigned jit_debug_info();
+
+/** A named range of generated code.
+ * \ingroup jit
+ */
+struct JitCodeSymbol {
+    std::string name;
+    uint64_t address;
+    uint64_t size;
+};
+
+/** The debug information published for one code buffer.
+ *
+ * Each \ref update publishes the buffer's current symbols; the destructor
+ * removes them from GDB again. The perf map cannot be shrunk, so perf relies
+ * on the process not reusing the address range for other code.
+ * \ingroup jit
+ */
+class JitDebugEntry {
+  public:
+    JitDebugEntry();
+    ~JitDebugEntry();
+    JitDebugEntry(const JitDebugEntry &) = delete;
+    JitDebugEntry &operator=(const JitDebugEntry &) = delete;
+
+    /** Publish `symbols` for the code at `code`, replacing the symbols of
+     * the previous update. Only symbols not published before are appended
+     * to the perf map.
+     */
+    void update(const void *code, uint64_t size,
+                const std::vector<JitCodeSymbol> &symbols);
+
+  private:
+    struct GdbEntry;
+    std::unique_ptr<GdbEntry> m_gdb;
+    std::set<std::tuple<uint64_t, uint64_t, std::string>> m_perf_symbols;
+};
+} // namespace day25
@@ -1,9 +1,112 @@
 #pragma once
 #include "executor.hpp"
 #include "jit.hpp"
+#include "profile.hpp"
 #include "program.hpp"
+#include "tape.hpp"
+
+#include <memory>
 
 namespace day25 {
+    /**
+     * The part of a turing machine the generated code works on.
+     *
+     * Each executor owns one, and passes it to the generated code on every call, so
+     * the same code can run any number of machines at once.
+     * \ingroup jit
+     */
+    struct JitContext {
+        uint8_t *tape;
+        uint64_t tape_size;
+        uint64_t tape_offset;
+        const char *state_name;
+        void *state_func;
+        //! Called for every step by code compiled with observer calls, if set.
+        Observer *observer;
+        //! Number of slots set, kept by code compiled with a checksum limit.
+        uint64_t ones;
+        //! \ref StopConditions::checksum_limit of the compiled program.
+        uint64_t checksum_limit;
+        //! Tape offsets the head must not move left or right of.
+        int64_t head_low;
+        int64_t head_high;
+        //! The \ref StopReason that ended the last call, stored by the code.
+        uint64_t stop_reason;
+    };
+
+    /**
+     * Machine code for a \ref Program, as run by \ref JitExecutor.
+     *
+     * Unlike other compiled programs, its states can be replaced after
+     * compiling, see \ref patch_states.
+     * \ingroup jit
+     */
+    class JitProgram : public CompiledProgram {
+    public:
+        /** Compile `program`. If `profile` is given, optimize the code layout for it, and
+         * with `traces`, also compile its most frequent paths into traces. With `observed`,
+         * the code calls the observer of the executor running it (see \ref emit_program).
+         * `pages` controls how the code buffer is allocated. The code checks `stop`, which all
+         * executors of the program must use.
+         */
+        JitProgram(Program program, const Profile *profile = nullptr,
+                   const PagePolicy &pages = PagePolicy(), bool traces = false,
+                   bool observed = false, const StopConditions &stop = StopConditions());
+        /** \throws std::runtime_error If `options` has an observer, but the program was
+         *         compiled without observer calls, or other stop conditions than it was
+         *         compiled for.
+         */
+        virtual std::shared_ptr<Executor>
+        instantiate(const ExecutorOptions &options = ExecutorOptions()) const override;
+        virtual MemoryUsage memory_usage() const override;
+
+        /** Continue the machine in `context` for up to `steps` steps.
+         *
+         * Returns the number of steps that were not executed, which is nonzero if the head left the tape.
+         * The generated code keeps no state of its own, so calls with different contexts may run
+         * concurrently.
+         */
+        uint64_t run(JitContext &context, uint64_t steps) const {
+            return m_run(&context, steps);
+        }
+        //! Store the name and code address of state `state` in `context`.
+        void enter_state(JitContext &context, const std::string &state) const;
+        const Jit &jit() const { return *m_jit; }
+        const StopConditions &stop_conditions() const { return m_stop; }
+
+        /** Replace the states with the names of `states`, or add them, without
+         * compiling the whole program again.
+         *
+         * The new code for each state goes behind the existing code, and all
+         * jumps into the old code are pointed at it. Only if the code buffer
+         * runs out of room, or if the program was compiled with traces, is the
+         * whole program compiled again, with the default layout and without
+         * traces, into a buffer twice as large.
+         *
+         * Executors keep the machines they run, including ones currently in a
+         * replaced state. The caller must make sure that none of them runs
+         * while this is called, e.g. by waiting for their \ref RunHandle "RunHandles".
+         * This is not checked, so that runs pay nothing for it.
+         * \throws std::runtime_error If the states refer to undefined states.
+         *         The program is left unchanged.
+         */
+        void patch_states(const std::vector<State> &states);
+        /** Number of times \ref patch_states compiled the whole program again.
+         *
+         * Code addresses stored in a \ref JitContext before that are no
+         * longer valid, use \ref enter_state again.
+         */
+        uint64_t generation() const { return m_generation; }
+    private:
+        std::unique_ptr<Jit> m_jit;
+        uint64_t (*m_run)(JitContext *context, uint64_t steps);
+        PagePolicy m_pages;
+        uint64_t m_generation;
+        bool m_traced;
+        bool m_observed;
+        StopConditions m_stop;
+    };
+
     /**
      * Executes \ref Program "Programs" by translating them into machine-code in memory.
      * \ingroup execution
@@ -15,21 +118,79 @@ namespace day25 {
      */
     class JitExecutor : public virtual Executor {
     public:
-        JitExecutor(Program program);
+        JitExecutor(Program program,
+                    const ExecutorOptions &options = ExecutorOptions());
+        //! Compile `program` with a code layout optimized for the transition counts in `profile`.
+        JitExecutor(Program program, const ExecutorOptions &options,
+                    const Profile &profile);
+        JitExecutor(std::shared_ptr<const JitProgram> compiled,
+                    const ExecutorOptions &options = ExecutorOptions());
         virtual ~JitExecutor() override;
         virtual void step() override;
+        virtual void run(uint64_t steps) override;
         virtual void reset() override;
-        virtual uint32_t diagnostic_checksum() override;
-        Jit &jit() { return *m_jit; }
+        virtual uint64_t diagnostic_checksum() override;
+        virtual uint64_t head() const override;
+        virtual uint64_t tape_size() const override;
+        virtual MemoryUsage memory_usage(bool measure_touched = true) const override;
+        virtual std::string state() const override;
+        virtual MachineState machine_state() const override;
+        virtual void restore_machine_state(const MachineState &state) override;
+        const Jit &jit() const { return m_compiled->jit(); }
     private:
-        const Program m_program;
-        Jit *m_jit;
-        uint8_t *m_tape;
-        uint64_t m_tape_size;
-        uint64_t m_tape_offset;
-        char *m_state_name;
-        void (*m_state_func)();
-        void compile();
-        void dump_state();
+        std::shared_ptr<const JitProgram> m_compiled;
+        Tape m_tape_memory;
+        JitContext m_context;
+        //! \ref JitProgram::generation the context's code addresses belong to.
+        uint64_t m_generation;
+        /** Tape offset of head position 0 of the stop conditions. Moves along when the tape
+         * grows or the head wraps around, so it may lie outside of the tape.
+         */
+        uint64_t m_origin;
+
+        //! Point the context's head bounds at the stop conditions, relative to \ref m_origin.
+        void update_stop_bounds();
     };
+
+    /** Return the size of the code buffer needed to compile `program` with \ref emit_program.
+     * \ingroup jit
+     */
+    uint32_t jit_code_size(const Program &program, const Profile *profile = nullptr,
+                           bool traces = false, bool observed = false,
+                           const StopConditions &stop = StopConditions());
+
+    /** Emit a function `run` into `jit` that executes `program`.
+     *
+     * `run(JitContext *context, uint64_t steps)` continues the machine in `context` in the state
+     * stored in its `state_func`, for at most `steps` steps (at most INT64_MAX). It returns the
+     * number of steps it did not execute, which is nonzero if the head left the tape.
+     * Each state's code starts at the symbol `state_<name>`, and its name, as stored in a
+     * context's `state_name`, at `state_name_<name>`. The names point into `program`, which
+     * must outlive the code.
+     *
+     * Without a `profile`, states are laid out in name order with the code for tape value 0 first.
+     * With a `profile`, frequently taken transitions become cache-line aligned chains of states
+     * that fall through into their likely successor, and rarely taken paths are moved out of line.
+     *
+     * With `traces` as well, each state whose most frequent path in the `profile` makes up at
+     * least a quarter of the paths recorded from it is entered through a trace: straight-line
+     * code for the whole path, which accesses the tape at constant offsets from the head, moves
+     * the head once at its end and checks the remaining steps and tape bounds once at its start.
+     * Only slots not written earlier in the trace are checked against the path ("guards"); if
+     * one differs, the trace exits to the code of the state that read it.
+     *
+     * With `observed`, every step first calls the context's `observer`, if set, and no traces
+     * are compiled. Without it, no code for observers is emitted at all.
+     *
+     * The state, head bound and checksum conditions in `stop` are checked by the code of each
+     * step: a compare and branch where a step can meet them, nothing elsewhere. Entering the
+     * stop state jumps straight to an exit, and only steps writing a one count the checksum,
+     * in RBX. A step that meets one stores its \ref StopReason in the context's `stop_reason`
+     * and returns. Steps that leave the tape return before their head and state checks.
+     * Programs with stop conditions get no traces.
+     * \ingroup jit
+     */
+    void emit_program(Jit *jit, const Program &program,
+                      const Profile *profile = nullptr, bool traces = false,
+                      bool observed = false, const StopConditions &stop = StopConditions());
 } // namespace day25
\ No newline at end of file
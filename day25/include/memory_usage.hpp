@@ -0,0 +1,58 @@
+#pragma once
+#include <cstdint>
+
+namespace day25 {
+/**
+ * Memory an executor, or a compiled program, holds. All sizes are in bytes.
+ *
+ * Code and tables belong to the \ref CompiledProgram and are shared by all
+ * executors instantiated from it; the tape belongs to each executor.
+ * \ingroup execution
+ */
+struct MemoryUsage {
+    //! Allocated for the tape.
+    uint64_t tape_reserved = 0;
+    //! Part of \ref tape_reserved that is backed by memory, i.e. was written to.
+    uint64_t tape_touched = 0;
+    //! What the tape would occupy if it grew to its maximum size.
+    uint64_t tape_maximum = 0;
+    //! Allocated for generated machine code.
+    uint64_t code_reserved = 0;
+    //! Part of \ref code_reserved that holds instructions.
+    uint64_t code_used = 0;
+    //! Bytecode and transition tables.
+    uint64_t tables = 0;
+    //! Constants and buffers the JIT allocated for the generated code.
+    uint64_t jit_data = 0;
+
+    //! Everything that is allocated, touched or not.
+    uint64_t total() const {
+        return tape_reserved + code_reserved + tables + jit_data;
+    }
+    MemoryUsage &operator+=(const MemoryUsage &other) {
+        tape_reserved += other.tape_reserved;
+        tape_touched += other.tape_touched;
+        tape_maximum += other.tape_maximum;
+        code_reserved += other.code_reserved;
+        code_used += other.code_used;
+        tables += other.tables;
+        jit_data += other.jit_data;
+        return *this;
+    }
+};
+
+/** Add the memory held by `tape` (a \ref BasicTape) to `usage`.
+ * \param measure_touched Also fill in \ref MemoryUsage::tape_touched, which
+ *                        may have to ask the kernel about every page.
+ * \relates MemoryUsage
+ */
+template <class TapeT>
+void add_tape_usage(MemoryUsage &usage, const TapeT &tape,
+                    bool measure_touched) {
+    usage.tape_reserved += tape.reserved_bytes();
+    usage.tape_maximum += tape.maximum_bytes();
+    if (measure_touched) {
+        usage.tape_touched += tape.touched_bytes();
+    }
+}
+} // namespace day25
@@ -0,0 +1,64 @@
+#pragma once
+#include <cstdint>
+#include <string>
+
+namespace day25 {
+/**
+ * Watches the steps an executor runs, e.g. to trace or visualize them or to
+ * measure coverage.
+ *
+ * For each step, the hooks are called in the order write, move, transition,
+ * before the step takes effect. `head` is the executor's \ref Executor::head
+ * at that time; once the tape grows to the left, the same index refers to a
+ * different slot.
+ *
+ * Select an observer at run time with \ref ExecutorOptions::observer. Tools
+ * that need no virtual calls instantiate an interpreter with their own
+ * observer policy instead, see \ref NullObserver.
+ * \ingroup execution
+ */
+class Observer {
+  public:
+    virtual ~Observer() {}
+    //! The slot at `head`, holding `old_value`, is written with `value`.
+    virtual void write(uint64_t /* head */, uint8_t /* old_value */,
+                       uint8_t /* value */) {}
+    //! The head moves from `head` by `direction`, -1 or 1.
+    virtual void move(uint64_t /* head */, int8_t /* direction */) {}
+    //! The machine continues in state `to` after a step in state `from`.
+    virtual void transition(const std::string & /* from */,
+                            const std::string & /* to */) {}
+};
+
+/**
+ * Observer policy for \ref BasicAstExecutor and \ref BasicBytecodeExecutor
+ * that ignores all steps. It is the default, so the hooks compile to nothing.
+ *
+ * Any class with the same member functions can take its place, like
+ * \ref ObserverRef.
+ * \ingroup execution
+ */
+struct NullObserver {
+    void write(uint64_t, uint8_t, uint8_t) {}
+    void move(uint64_t, int8_t) {}
+    void transition(const std::string &, const std::string &) {}
+};
+
+/**
+ * Observer policy that forwards to an \ref Observer.
+ * \ingroup execution
+ */
+struct ObserverRef {
+    Observer *observer;
+
+    void write(uint64_t head, uint8_t old_value, uint8_t value) {
+        observer->write(head, old_value, value);
+    }
+    void move(uint64_t head, int8_t direction) {
+        observer->move(head, direction);
+    }
+    void transition(const std::string &from, const std::string &to) {
+        observer->transition(from, to);
+    }
+};
+} // namespace day25
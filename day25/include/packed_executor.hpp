@@ -0,0 +1,99 @@
+#pragma once
+#include "bytecode_executor.hpp"
+#include "executor.hpp"
+#include "program.hpp"
+#include "tape.hpp"
+#include <vector>
+
+namespace day25 {
+/** The tape of \ref PackedExecutor: eight slots per byte.
+ * \ingroup execution
+ */
+typedef BasicTape<BitCells, MmapStorage, GrowableBoundary> PackedTape;
+
+/**
+ * What happens when the head is in one byte of a \ref PackedTape, until it
+ * leaves that byte.
+ * \ingroup execution
+ */
+struct PackedTransition {
+    //! State after the head left the byte.
+    uint32_t next_state;
+    /** Steps until the head leaves the byte. 0 if it never does, or if
+     * the transition has to be run step by step for other reasons.
+     */
+    uint32_t steps;
+    //! Contents of the byte when the head leaves it.
+    uint8_t byte;
+    //! -1 if the head leaves the byte to the left, 1 if to the right.
+    int8_t exit_direction;
+};
+
+/**
+ * Bytecode for a \ref Program, plus a table of \ref PackedTransition "transitions"
+ * for every state, byte value and head position within the byte, as run by
+ * \ref PackedExecutor.
+ *
+ * States are numbered as in \ref BytecodeProgram. The table holds
+ * 2048 entries per state, so it is limited to \ref MAX_STATES states.
+ * \ingroup execution
+ */
+class PackedProgram : public BytecodeProgram {
+  public:
+    //! Largest number of states the table is built for.
+    static const uint32_t MAX_STATES = 1024;
+
+    /** \throws std::runtime_error If the program has more than
+     * \ref MAX_STATES states.
+     */
+    PackedProgram(Program program);
+    virtual std::shared_ptr<Executor>
+    instantiate(const ExecutorOptions &options = ExecutorOptions()) const;
+    virtual MemoryUsage memory_usage() const;
+
+    //! The transition for `state` with the head at bit `position` of `byte`.
+    const PackedTransition &transition(uint32_t state, uint8_t byte,
+                                       unsigned position) const {
+        return m_transitions[(state * 256 + byte) * 8 + position];
+    }
+
+  private:
+    std::vector<PackedTransition> m_transitions;
+};
+
+/** Runs \ref Program "Programs" on a bit-packed tape, a byte at a time.
+ *
+ * While the head stays within one byte, the machine only depends on the
+ * state, the byte and the head position, so a single lookup in the
+ * \ref PackedProgram table runs all steps until the head leaves the byte.
+ * Transitions that would run past the requested number of steps, never
+ * leave their byte, or touch the partial byte at the end of the tape are
+ * run step by step, so the executor stops at exactly the same point as all
+ * others. `day25 check program packed` verifies that it does.
+ * \ingroup execution
+ */
+class PackedExecutor : public virtual Executor {
+  public:
+    PackedExecutor(Program program,
+                   const ExecutorOptions &options = ExecutorOptions());
+    PackedExecutor(std::shared_ptr<const PackedProgram> compiled,
+                   const ExecutorOptions &options = ExecutorOptions());
+    virtual ~PackedExecutor();
+    virtual void step();
+    virtual void run(uint64_t steps);
+    virtual void reset();
+    virtual uint64_t diagnostic_checksum();
+    virtual uint64_t head() const;
+    virtual uint64_t tape_size() const;
+    virtual MemoryUsage memory_usage(bool measure_touched = true) const;
+    virtual std::string state() const;
+    virtual MachineState machine_state() const;
+    virtual void restore_machine_state(const MachineState &state);
+
+  private:
+    std::shared_ptr<const PackedProgram> m_compiled;
+    PackedTape m_tape;
+    uint64_t m_head;
+    uint32_t m_state;
+};
+} // namespace day25
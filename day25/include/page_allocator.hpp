@@ -0,0 +1,72 @@
+#pragma once
+#include <cstdint>
+
+namespace day25 {
+/** Which page size to back tapes and generated code with.
+ * \ingroup execution
+ */
+enum class HugePages {
+    //! Normal pages.
+    NONE,
+    //! Ask the kernel to use transparent huge pages where it can.
+    TRANSPARENT,
+    /** Map explicit huge pages from the pool reserved in
+     * `/proc/sys/vm/nr_hugepages`, for regions of at least
+     * \ref HUGE_PAGE_SIZE. Falls back to transparent huge pages if the pool
+     * is empty.
+     */
+    EXPLICIT,
+};
+
+/** Size of an explicit huge page.
+ * \ingroup execution
+ */
+const uint64_t HUGE_PAGE_SIZE = 2 << 20;
+
+/**
+ * How to allocate memory for tapes and generated code.
+ * \ingroup execution
+ */
+struct PagePolicy {
+    HugePages huge_pages = HugePages::NONE;
+    /** Prefer memory on this NUMA node, e.g. the one a batch worker is pinned
+     * to (see \ref current_numa_node). -1 leaves placement to the kernel,
+     * which uses the node of the thread that first writes each page.
+     */
+    int numa_node = -1;
+};
+
+/** An anonymous memory mapping, allocated according to a \ref PagePolicy.
+ * \ingroup execution
+ */
+struct PageMapping {
+    void *address;
+    //! Bytes mapped; may be more than requested, see \ref map_pages.
+    uint64_t size;
+    //! Whether the mapping uses explicit huge pages.
+    bool huge;
+};
+
+/** Map at least `size` bytes of zeroed, anonymous memory with protection
+ * `prot` (`PROT_*` flags).
+ *
+ * With \ref HugePages::EXPLICIT, sizes of at least \ref HUGE_PAGE_SIZE are
+ * rounded up to whole huge pages.
+ * \throws std::runtime_error If the memory could not be mapped.
+ * \ingroup execution
+ */
+PageMapping map_pages(uint64_t size, const PagePolicy &policy, int prot);
+
+/** Apply the transparent huge page and NUMA settings of `policy` to an
+ * existing mapping, e.g. after it was resized with `mremap`.
+ *
+ * Both are hints: if the kernel does not support them, nothing happens.
+ * \ingroup execution
+ */
+void apply_page_policy(void *address, uint64_t size, const PagePolicy &policy);
+
+/** NUMA node of the CPU the calling thread runs on, or -1 if unknown.
+ * \ingroup execution
+ */
+int current_numa_node();
+} // namespace day25
@@ -0,0 +1,54 @@
+#pragma once
+#include "program.hpp"
+#include <array>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <utility>
+
+namespace day25 {
+//! Number of steps in the paths \ref collect_profile records.
+const unsigned PROFILE_PATH_LENGTH = 16;
+
+/**
+ * How often each \ref StateAction of a \ref Program ran during a profiling run.
+ * \ingroup execution
+ */
+struct Profile {
+    //! Map from state name to the number of times the action for tape value 0 and 1 ran.
+    std::map<std::string, std::array<uint64_t, 2>> transitions;
+    /** Map from state name to the paths recorded starting in that state, and how
+     * often each was seen.
+     *
+     * A path is the sequence of tape values read in \ref PROFILE_PATH_LENGTH
+     * consecutive steps, the one read first in the lowest bit. Together with
+     * the program, it determines the states visited.
+     */
+    std::map<std::string, std::map<uint32_t, uint64_t>> paths;
+
+    //! Number of times `state` ran with tape value `slot`.
+    uint64_t count(const std::string &state, unsigned slot) const;
+    //! Number of times `state` ran at all.
+    uint64_t count(const std::string &state) const;
+    //! The tape value `state` saw most often. 0 if the state never ran.
+    unsigned likely_slot(const std::string &state) const;
+    /** The path starting in `state` seen most often, and the share of all
+     * paths recorded starting in `state` it makes up. A share of 0 if none
+     * was recorded.
+     */
+    std::pair<uint32_t, double> likely_path(const std::string &state) const;
+};
+
+//! Number of steps the `jit-pgo` executor profiles before compiling.
+const uint64_t DEFAULT_PROFILE_STEPS = 1000000;
+
+/** Run `program` for up to `steps` steps, count the transitions taken and
+ * record paths.
+ *
+ * Paths are recorded back to back: each starts in the state the previous
+ * one ended in.
+ * \relates Profile
+ * \ingroup execution
+ */
+Profile collect_profile(const Program &program, uint64_t steps);
+} // namespace day25
@@ -6,6 +6,8 @@
 #include <vector>
 
 namespace day25 {
+struct State;
+
     /**
      * Represents what to do in a specific state for a specific current tape value.
      *
@@ -22,6 +24,8 @@ struct StateAction {
     int move_direction;
     //! Continue with this state afterwards.
     std::string next_state;
+    //! The \ref State named by \ref next_state. Set by \ref Program::link.
+    const State *next_state_link = nullptr;
 };
 
 /**
@@ -36,18 +40,49 @@ struct State {
     std::string name;
     //! Map from (current tape value) to (\ref StateAction to perform for this value). Typically contains the keys 0 and 1.
     std::map<unsigned, StateAction> actions;
+    //! Pointers into \ref actions, indexed by tape value. Set by \ref Program::link.
+    const StateAction *action_links[2] = {nullptr, nullptr};
 };
 
 /**
  * Describes an entire program, including initialization and all states.
+ *
+ * After \ref link, states and actions also refer to each other by pointer, so
+ * executors can follow transitions without looking up names. Copies of a
+ * linked program are linked again, so the pointers always refer into the
+ * same program.
  */
 struct Program {
+    Program() = default;
+    Program(const Program &other);
+    Program(Program &&other) = default;
+    Program &operator=(const Program &other);
+    Program &operator=(Program &&other) = default;
+
     //! Name of the state the turing machine should start in.
     std::string initial_state;
     //! Number of steps to run before calculating the checksum.
-    uint32_t checksum_delay;
+    uint64_t checksum_delay = 0;
     //! Map from (state name) to \ref State
     std::map<std::string, State> states;
+    //! The \ref State named by \ref initial_state. Set by \ref link.
+    const State *initial_state_link = nullptr;
+
+    /** Resolve all state names and action slots into pointers.
+     * \throws std::runtime_error If a state name is undefined or a state
+     *         lacks the action for tape value 0 or 1.
+     */
+    void link();
+    /** Resolve the names in `state`, one of \ref states, e.g. after replacing it.
+     *
+     * Links to a replaced state stay valid, as long as it is assigned to, not
+     * erased and inserted again.
+     * \throws std::runtime_error Like \ref link.
+     */
+    void link_state(State &state);
+
+  private:
+    const State *find_state(const std::string &name) const;
 };
 
 std::ostream &operator<<(std::ostream &os, const Program &program);
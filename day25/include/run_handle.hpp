@@ -0,0 +1,95 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <memory>
+
+namespace day25 {
+/**
+ * Snapshot of the progress of an asynchronous run.
+ * \ingroup execution
+ */
+struct RunProgress {
+    //! Steps executed by this run so far.
+    uint64_t steps_done;
+    //! Steps the run was asked to execute.
+    uint64_t steps_requested;
+    //! Throughput over the most recent check interval.
+    double steps_per_second;
+};
+
+/**
+ * How an asynchronous run ended.
+ * \ingroup execution
+ */
+enum class RunResult {
+    //! All requested steps were executed.
+    COMPLETED,
+    //! \ref RunHandle::cancel was called.
+    CANCELLED,
+    //! The deadline passed before all steps were executed.
+    DEADLINE_EXCEEDED,
+    //! Continuing would have grown the executor beyond \ref RunOptions::memory_limit.
+    MEMORY_LIMIT_EXCEEDED,
+    //! A stop condition held, see \ref Executor::stop_event.
+    STOPPED,
+};
+
+/**
+ * Settings for \ref Executor::run_async.
+ * \ingroup execution
+ */
+struct RunOptions {
+    typedef std::chrono::steady_clock Clock;
+    //! Steps between two checks for cancellation, deadline and progress.
+    uint64_t check_interval = 1 << 20;
+    //! Stop once this point in time has passed.
+    Clock::time_point deadline = Clock::time_point::max();
+    /** If nonzero, the most bytes the executor may hold (see
+     * \ref MemoryUsage::total).
+     *
+     * A run that starts above the limit is rejected right away. Otherwise,
+     * steps that might grow the tape past the limit are not executed; the run
+     * stops before them, so the machine can be checkpointed and continued
+     * elsewhere.
+     */
+    uint64_t memory_limit = 0;
+    //! If set, called on the worker thread after every check interval.
+    std::function<void(const RunProgress &)> on_progress;
+};
+
+/**
+ * Controls a run started with \ref Executor::run_async.
+ *
+ * Copies refer to the same run. Destroying all handles does not stop the run
+ * either: destroying the last one blocks until the run has ended, like
+ * \ref wait. Call \ref cancel first to end it sooner.
+ * \ingroup execution
+ */
+class RunHandle {
+  public:
+    //! Ask the run to stop at its next check.
+    void cancel();
+    //! Steps done so far and current throughput.
+    RunProgress progress() const;
+    //! Whether the run has ended.
+    bool done() const;
+    /** Block until the run has ended.
+     * \throws std::runtime_error (or other exceptions) thrown by the executor.
+     */
+    RunResult wait() const;
+
+  private:
+    friend class Executor;
+    struct Shared {
+        std::atomic<bool> cancelled{false};
+        std::atomic<uint64_t> steps_done{0};
+        std::atomic<double> steps_per_second{0};
+        uint64_t steps_requested = 0;
+    };
+    std::shared_ptr<Shared> m_shared;
+    std::shared_future<RunResult> m_result;
+};
+} // namespace day25
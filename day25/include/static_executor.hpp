@@ -0,0 +1,224 @@
+#pragma once
+#include "executor.hpp"
+#include "program.hpp"
+#include "tape.hpp"
+#include <cstdint>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+namespace day25 {
+/**
+ * One entry of the transition table in an embedded program spec.
+ * \ingroup execution
+ */
+struct StaticAction {
+    uint8_t write_value;
+    int8_t move_direction;
+    //! Index into the spec's `state_names`.
+    uint32_t next_state;
+};
+
+/**
+ * A program that was embedded at build time, as run by \ref StaticExecutor.
+ *
+ * `Spec` is a struct written by \ref generate_static_spec, holding the
+ * program as `constexpr` data:
+ * \code
+ * struct Spec {
+ *     static constexpr const char *name = "...";
+ *     static constexpr uint32_t STATE_COUNT = ...;
+ *     static constexpr uint32_t INITIAL_STATE = ...;
+ *     static constexpr const char *state_names[STATE_COUNT] = {...};
+ *     static constexpr StaticAction actions[STATE_COUNT][2] = {...};
+ * };
+ * \endcode
+ * Nothing is translated at run time. The constructor only checks that the
+ * program it is given is the one that was embedded, since the tape size
+ * still comes from its `checksum_delay`.
+ * \ingroup execution
+ */
+template <class Spec> class StaticProgram : public CompiledProgram {
+  public:
+    /** \throws std::runtime_error If `program` has different states or
+     * actions than `Spec`.
+     */
+    StaticProgram(Program program) : CompiledProgram(check(program)) {}
+    virtual std::shared_ptr<Executor>
+    instantiate(const ExecutorOptions &options = ExecutorOptions()) const;
+
+    /** Index of the state named `name`.
+     * \throws std::runtime_error If there is no such state.
+     */
+    static uint32_t state_index(const std::string &name) {
+        for (uint32_t i = 0; i < Spec::STATE_COUNT; i++) {
+            if (name == Spec::state_names[i]) {
+                return i;
+            }
+        }
+        throw std::runtime_error("Checkpoint does not match program.");
+    }
+
+  private:
+    static Program check(Program program) {
+        auto mismatch = std::runtime_error(
+            std::string("Program does not match static:") + Spec::name + ".");
+        if (program.states.size() != Spec::STATE_COUNT ||
+            program.initial_state != Spec::state_names[Spec::INITIAL_STATE]) {
+            throw mismatch;
+        }
+        for (uint32_t i = 0; i < Spec::STATE_COUNT; i++) {
+            auto state = program.states.find(Spec::state_names[i]);
+            if (state == program.states.end()) {
+                throw mismatch;
+            }
+            for (unsigned slot = 0; slot <= 1; slot++) {
+                auto &action = state->second.actions.at(slot);
+                auto &expected = Spec::actions[i][slot];
+                if (action.write_value != expected.write_value ||
+                    action.move_direction != expected.move_direction ||
+                    action.next_state !=
+                        Spec::state_names[expected.next_state]) {
+                    throw mismatch;
+                }
+            }
+        }
+        return program;
+    }
+};
+
+/**
+ * Runs a program embedded at build time.
+ *
+ * Every state is a separate instantiation of \ref execute, so the compiler
+ * sees the actions of each state as constants and can turn the dispatch
+ * into a jump table.
+ * \ingroup execution
+ */
+template <class Spec, class TapeT = Tape>
+class StaticExecutor : public virtual Executor {
+  public:
+    StaticExecutor(std::shared_ptr<const StaticProgram<Spec>> compiled,
+                   const ExecutorOptions &options = ExecutorOptions())
+        : m_compiled(compiled),
+          m_tape(compiled->program().checksum_delay, options.tape_file,
+                 options.tape_advice,
+                 options.pages) {
+        reset();
+    }
+    virtual ~StaticExecutor() {}
+
+    virtual void step() {
+        m_state = dispatch(States());
+        m_steps++;
+    }
+    virtual void run(uint64_t steps) {
+        for (uint64_t i = 0; i < steps; i++) {
+            m_state = dispatch(States());
+        }
+        m_steps += steps;
+    }
+    virtual void reset() {
+        m_tape.clear();
+        m_head = m_tape.origin();
+        m_state = Spec::INITIAL_STATE;
+        m_steps = 0;
+    }
+    virtual uint64_t diagnostic_checksum() { return m_tape.checksum(); }
+    virtual uint64_t head() const { return m_head; }
+    virtual uint64_t tape_size() const { return m_tape.size(); }
+    //! The transition table is part of the binary, only the tape counts.
+    virtual MemoryUsage memory_usage(bool measure_touched = true) const {
+        MemoryUsage usage;
+        add_tape_usage(usage, m_tape, measure_touched);
+        return usage;
+    }
+    virtual std::string state() const { return Spec::state_names[m_state]; }
+    virtual MachineState machine_state() const {
+        return MachineState{
+            .tape = m_tape.contents(),
+            .head = m_head,
+            .state = Spec::state_names[m_state],
+            .steps = m_steps,
+        };
+    }
+    virtual void restore_machine_state(const MachineState &state) {
+        auto index = StaticProgram<Spec>::state_index(state.state);
+        m_tape.assign(state.tape);
+        m_head = state.head;
+        m_state = index;
+        m_steps = state.steps;
+    }
+
+  private:
+    typedef std::make_integer_sequence<uint32_t, Spec::STATE_COUNT> States;
+
+    std::shared_ptr<const StaticProgram<Spec>> m_compiled;
+    TapeT m_tape;
+    uint64_t m_head;
+    uint32_t m_state;
+
+    //! Run one step in state `S` and return the next state.
+    template <uint32_t S> uint32_t execute() {
+        constexpr StaticAction zero = Spec::actions[S][0];
+        constexpr StaticAction one = Spec::actions[S][1];
+        if (m_tape.get(m_head) == 0) {
+            m_tape.set(m_head, zero.write_value);
+            m_head = m_tape.move(m_head, zero.move_direction);
+            return zero.next_state;
+        } else {
+            m_tape.set(m_head, one.write_value);
+            m_head = m_tape.move(m_head, one.move_direction);
+            return one.next_state;
+        }
+    }
+    //! Run one step in the current state.
+    template <uint32_t... S>
+    uint32_t dispatch(std::integer_sequence<uint32_t, S...>) {
+        uint32_t next = 0;
+        ((m_state == S && (next = execute<S>(), true)) || ...);
+        return next;
+    }
+};
+
+template <class Spec>
+std::shared_ptr<Executor>
+StaticProgram<Spec>::instantiate(const ExecutorOptions &options) const {
+    if (options.observer) {
+        throw std::runtime_error(
+            "Static executors do not support observers.");
+    }
+    if (options.stop.active()) {
+        throw std::runtime_error(
+            "Static executors do not support stop conditions.");
+    }
+    return std::make_shared<StaticExecutor<Spec>>(
+        std::static_pointer_cast<const StaticProgram>(shared_from_this()),
+        options);
+}
+
+/** Make `Spec` available as executor type `static:<name>`.
+ *
+ * Embedded spec headers call this from a static initializer.
+ * \relates StaticProgram
+ * \ingroup execution
+ */
+template <class Spec> bool register_static_executor() {
+    register_executor(std::string("static:") + Spec::name, [](Program p, auto &) {
+        return std::make_shared<StaticProgram<Spec>>(p);
+    });
+    return true;
+}
+
+/** Write a C++ header that embeds `program` as executor `static:<name>`.
+ *
+ * The header defines the spec struct described in \ref StaticProgram, named
+ * after `name` with all characters that are not valid in identifiers
+ * replaced, and registers it with \ref register_static_executor when it is
+ * included. The `d25_embed_program` CMake function runs this at build time.
+ * \ingroup codegen
+ */
+void generate_static_spec(std::ostream &os, const Program &program,
+                          const std::string &name);
+} // namespace day25
@@ -0,0 +1,151 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <string>
+
+namespace day25 {
+/**
+ * Conditions that end \ref Executor::run before all requested steps ran.
+ *
+ * Each condition is checked after every step, in the order of
+ * \ref StopReason; the first one that holds ends the run and is reported by
+ * \ref Executor::stop_event. The executor can continue with the next run.
+ * \ingroup execution
+ */
+struct StopConditions {
+    //! Stop after a step that enters this state (none if empty).
+    std::string state;
+    /** Stop after a step that moves the head left of `head_min` or right of
+     * `head_max`, relative to the slot it started on after \ref
+     * Executor::reset, or to its position after \ref
+     * Executor::restore_machine_state. Positions count moves, so they keep
+     * growing when the head wraps around the ends of a tape.
+     */
+    int64_t head_min = INT64_MIN;
+    int64_t head_max = INT64_MAX;
+    //! Stop after every `step_multiple` steps, counted since reset (none if 0).
+    uint64_t step_multiple = 0;
+    //! Stop after a step that raises the checksum above this.
+    uint64_t checksum_limit = UINT64_MAX;
+
+    bool has_state() const { return !state.empty(); }
+    bool has_head_bounds() const {
+        return head_min != INT64_MIN || head_max != INT64_MAX;
+    }
+    bool has_checksum_limit() const { return checksum_limit != UINT64_MAX; }
+    //! Whether any condition is set.
+    bool active() const {
+        return has_state() || has_head_bounds() || step_multiple ||
+               has_checksum_limit();
+    }
+    /** Number of steps, up to `steps`, to run before the next multiple of
+     * \ref step_multiple, after `steps_executed` steps.
+     */
+    uint64_t steps_to_multiple(uint64_t steps_executed, uint64_t steps) const {
+        if (!step_multiple) {
+            return steps;
+        }
+        return std::min(steps, step_multiple - steps_executed % step_multiple);
+    }
+    bool operator==(const StopConditions &other) const {
+        return state == other.state && head_min == other.head_min &&
+               head_max == other.head_max &&
+               step_multiple == other.step_multiple &&
+               checksum_limit == other.checksum_limit;
+    }
+};
+
+/** Which \ref StopConditions ended a run, in the order they are checked.
+ * \ingroup execution
+ */
+enum class StopReason {
+    //! The run executed all requested steps.
+    NONE,
+    CHECKSUM,
+    HEAD,
+    STATE,
+    STEP_MULTIPLE,
+};
+
+/** Why and when the last run ended.
+ * \ingroup execution
+ */
+struct StopEvent {
+    StopReason reason = StopReason::NONE;
+    //! Steps executed when the condition held.
+    uint64_t step = 0;
+};
+
+/** Name of `reason` for messages, e.g. "checksum".
+ * \ingroup execution
+ */
+const char *stop_reason_name(StopReason reason);
+
+/**
+ * Checks \ref StopConditions step by step, for the interpreters.
+ * \ingroup execution
+ */
+class StopTracker {
+  public:
+    StopTracker(const StopConditions &conditions)
+        : m_conditions(conditions), m_active(conditions.active()) {}
+    const StopConditions &conditions() const { return m_conditions; }
+    bool active() const { return m_active; }
+
+    //! Measure head positions from here, and start with `ones` slots set.
+    void start(uint64_t ones) {
+        m_position = 0;
+        m_ones = ones;
+    }
+    /** Account for a step that wrote `value` over `slot` and moved the head
+     * in `direction`. `entered_stop_state` tells whether it entered
+     * \ref StopConditions::state.
+     */
+    StopReason after_step(uint8_t slot, uint8_t value, int8_t direction,
+                          bool entered_stop_state) {
+        m_ones += value - slot;
+        m_position += direction;
+        if (value > slot && m_ones > m_conditions.checksum_limit) {
+            return StopReason::CHECKSUM;
+        }
+        if (direction < 0 ? m_position < m_conditions.head_min
+                          : m_position > m_conditions.head_max) {
+            return StopReason::HEAD;
+        }
+        if (entered_stop_state) {
+            return StopReason::STATE;
+        }
+        return StopReason::NONE;
+    }
+    /** Call `step` up to `steps` times, until it returns a reason other than
+     * \ref StopReason::NONE or `steps_executed` reaches a multiple of
+     * \ref StopConditions::step_multiple.
+     */
+    template <class Step>
+    StopEvent run(uint64_t steps, const uint64_t &steps_executed, Step step) {
+        while (steps) {
+            auto block = m_conditions.steps_to_multiple(steps_executed, steps);
+            for (uint64_t i = 0; i < block; i++) {
+                auto reason = step();
+                if (reason != StopReason::NONE) {
+                    return StopEvent{reason, steps_executed};
+                }
+            }
+            steps -= block;
+            if (m_conditions.step_multiple &&
+                steps_executed % m_conditions.step_multiple == 0) {
+                return StopEvent{StopReason::STEP_MULTIPLE, steps_executed};
+            }
+        }
+        return StopEvent();
+    }
+
+  private:
+    StopConditions m_conditions;
+    bool m_active;
+    //! Head position, counted in moves since \ref start.
+    int64_t m_position = 0;
+    //! Number of slots set, i.e. the checksum.
+    uint64_t m_ones = 0;
+};
+} // namespace day25
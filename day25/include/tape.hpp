@@ -0,0 +1,426 @@
+#pragma once
+#include "tape_memory.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace day25 {
+/**
+ * \name Cell policies
+ * How slots are packed into the units a storage policy holds.
+ * Each has a `Unit` type, the number of slots per unit, and functions to
+ * read, write and sum the slots of one unit.
+ * @{
+ */
+
+//! One slot per byte.
+struct ByteCells {
+    typedef uint8_t Unit;
+    static const unsigned PER_UNIT = 1;
+    static constexpr const char *name = "byte";
+    static uint8_t get(Unit unit, unsigned) { return unit; }
+    static Unit set(Unit, unsigned, uint8_t value) { return value; }
+    static uint64_t sum(Unit unit) { return unit; }
+};
+
+//! Eight slots per byte.
+struct BitCells {
+    typedef uint8_t Unit;
+    static const unsigned PER_UNIT = 8;
+    static constexpr const char *name = "bit";
+    static uint8_t get(Unit unit, unsigned index) {
+        return (unit >> index) & 1;
+    }
+    static Unit set(Unit unit, unsigned index, uint8_t value) {
+        return (unit & ~(1u << index)) | ((value & 1u) << index);
+    }
+    static uint64_t sum(Unit unit) { return __builtin_popcount(unit); }
+};
+
+//! One slot per 16-bit word.
+struct U16Cells {
+    typedef uint16_t Unit;
+    static const unsigned PER_UNIT = 1;
+    static constexpr const char *name = "u16";
+    static uint8_t get(Unit unit, unsigned) { return unit; }
+    static Unit set(Unit, unsigned, uint8_t value) { return value; }
+    static uint64_t sum(Unit unit) { return unit; }
+};
+/** @} */
+
+/**
+ * \name Storage policies
+ * Hold a resizable sequence of zero-initialized units.
+ * @{
+ */
+
+//! A single `std::vector`.
+template <class Unit> class FlatStorage {
+  public:
+    static constexpr const char *name = "flat";
+
+    FlatStorage(uint64_t units, const std::string &filename, TapeAdvice,
+                const PagePolicy &)
+        : m_units(units) {
+        if (!filename.empty()) {
+            throw std::runtime_error("Tape files need mmap storage.");
+        }
+    }
+    uint64_t size() const { return m_units.size(); }
+    Unit load(uint64_t index) const { return m_units[index]; }
+    void store(uint64_t index, Unit unit) { m_units[index] = unit; }
+    Unit *data() { return m_units.data(); }
+    const Unit *data() const { return m_units.data(); }
+    //! Change the number of units. Added units are zero.
+    void resize(uint64_t units) { m_units.resize(units); }
+    //! Insert `units` zero units before the first one.
+    void shift_up(uint64_t units) {
+        m_units.insert(m_units.begin(), units, 0);
+    }
+    void clear() { std::fill(m_units.begin(), m_units.end(), 0); }
+    uint64_t reserved_bytes() const { return m_units.capacity() * sizeof(Unit); }
+    //! All units are written when they are added.
+    uint64_t touched_bytes() const { return m_units.size() * sizeof(Unit); }
+
+  private:
+    std::vector<Unit> m_units;
+};
+
+/** Fixed-size chunks that are only allocated when written to.
+ *
+ * Untouched regions cost no memory, clearing just drops all chunks, and
+ * growing to the left by whole chunks does not move any data.
+ */
+template <class Unit> class ChunkedStorage {
+  public:
+    static constexpr const char *name = "chunked";
+    //! Units per chunk (one page).
+    static constexpr uint64_t CHUNK = 4096 / sizeof(Unit);
+
+    ChunkedStorage(uint64_t units, const std::string &filename, TapeAdvice,
+                   const PagePolicy &)
+        : m_size(0) {
+        if (!filename.empty()) {
+            throw std::runtime_error("Tape files need mmap storage.");
+        }
+        resize(units);
+    }
+    uint64_t size() const { return m_size; }
+    Unit load(uint64_t index) const {
+        auto &chunk = m_chunks[index / CHUNK];
+        return chunk ? chunk[index % CHUNK] : 0;
+    }
+    void store(uint64_t index, Unit unit) {
+        auto &chunk = m_chunks[index / CHUNK];
+        if (!chunk) {
+            chunk.reset(new Unit[CHUNK]());
+        }
+        chunk[index % CHUNK] = unit;
+    }
+    void resize(uint64_t units) {
+        if (units < m_size && units % CHUNK && m_chunks[units / CHUNK]) {
+            // Keep the rest of the last chunk zero for when it grows again.
+            auto &chunk = m_chunks[units / CHUNK];
+            std::fill(&chunk[units % CHUNK], &chunk[CHUNK], 0);
+        }
+        m_chunks.resize((units + CHUNK - 1) / CHUNK);
+        m_size = units;
+    }
+    void shift_up(uint64_t units) {
+        if (units % CHUNK == 0) {
+            std::vector<std::unique_ptr<Unit[]>> added(units / CHUNK);
+            m_chunks.insert(m_chunks.begin(),
+                            std::make_move_iterator(added.begin()),
+                            std::make_move_iterator(added.end()));
+            m_size += units;
+            return;
+        }
+        ChunkedStorage shifted(m_size + units, "", TapeAdvice::NORMAL,
+                               PagePolicy());
+        for (uint64_t i = 0; i < m_size; i++) {
+            if (auto unit = load(i)) {
+                shifted.store(i + units, unit);
+            }
+        }
+        std::swap(m_chunks, shifted.m_chunks);
+        m_size = shifted.m_size;
+    }
+    void clear() {
+        auto chunks = m_chunks.size();
+        m_chunks.clear();
+        m_chunks.resize(chunks);
+    }
+    //! Chunk table, plus the chunks it could point to.
+    uint64_t reserved_bytes() const {
+        return m_chunks.capacity() * sizeof(m_chunks[0]) +
+               m_chunks.size() * CHUNK * sizeof(Unit);
+    }
+    //! Chunk table, plus the chunks that were written to.
+    uint64_t touched_bytes() const {
+        uint64_t allocated = 0;
+        for (auto &chunk : m_chunks) {
+            allocated += chunk != nullptr;
+        }
+        return m_chunks.capacity() * sizeof(m_chunks[0]) +
+               allocated * CHUNK * sizeof(Unit);
+    }
+
+  private:
+    std::vector<std::unique_ptr<Unit[]>> m_chunks;
+    uint64_t m_size;
+};
+
+//! Anonymous or file-backed \ref TapeMemory.
+template <class Unit> class MmapStorage {
+  public:
+    static constexpr const char *name = "mmap";
+
+    MmapStorage(uint64_t units, const std::string &filename,
+                TapeAdvice advice, const PagePolicy &pages)
+        : m_memory(units * sizeof(Unit), filename, advice, pages) {}
+    uint64_t size() const { return m_memory.size() / sizeof(Unit); }
+    Unit load(uint64_t index) const { return data()[index]; }
+    void store(uint64_t index, Unit unit) { data()[index] = unit; }
+    Unit *data() const { return (Unit *)m_memory.data(); }
+    void resize(uint64_t units) { m_memory.resize(units * sizeof(Unit)); }
+    void shift_up(uint64_t units) {
+        auto old_size = size();
+        resize(old_size + units);
+        memmove(data() + units, data(), old_size * sizeof(Unit));
+        memset(data(), 0, units * sizeof(Unit));
+    }
+    void clear() { m_memory.clear(); }
+    uint64_t reserved_bytes() const { return m_memory.size(); }
+    uint64_t touched_bytes() const { return m_memory.resident_size(); }
+
+  private:
+    TapeMemory m_memory;
+};
+/** @} */
+
+/**
+ * \name Boundary policies
+ * What happens when the head moves past either end of the tape.
+ * @{
+ */
+
+/** Start small and double whenever the head moves past either end, up to
+ * `max_size` slots, then wrap around.
+ */
+struct GrowableBoundary {
+    static const bool GROWS = true;
+    static constexpr const char *name = "growable";
+};
+
+//! Allocate all `max_size` slots up front and wrap around at the ends.
+struct CircularBoundary {
+    static const bool GROWS = false;
+    static constexpr const char *name = "circular";
+};
+/** @} */
+
+/**
+ * A tape of `max_size` slots, holding 0 or 1 each, assembled from a cell, a
+ * storage and a boundary policy.
+ *
+ * With \ref GrowableBoundary, the tape only occupies memory for the region
+ * the head has visited: it starts out small and doubles whenever the head
+ * moves past either end, up to `max_size` slots. From then on it wraps
+ * around, so a tape of `checksum_delay` slots behaves like an infinite tape
+ * for the first `checksum_delay` steps. Memory use is proportional to the
+ * distance the head travelled, not to the number of steps.
+ *
+ * Executors either call \ref move, or move the head within `[0, size())`
+ * themselves and only call \ref extend_left or \ref extend_right when it
+ * leaves that range.
+ * \ingroup execution
+ */
+template <class Cells, template <class> class Storage, class Boundary>
+class BasicTape {
+  public:
+    typedef typename Cells::Unit Unit;
+
+    /** Number of slots allocated before the head moves at all, if the tape
+     * grows.
+     *
+     * One page of bytes, so that \ref clear only has to zero a single page
+     * beyond what the previous run grew the tape to.
+     */
+    static constexpr uint64_t INITIAL_SIZE = 4096;
+
+    /**
+     * \param max_size Maximum number of slots, typically `checksum_delay`.
+     * \param filename If non-empty, back the tape with this file.
+     * \param advice Access pattern hint for the tape memory.
+     * \param pages Page size and NUMA placement, for mmap storage.
+     */
+    BasicTape(uint64_t max_size, const std::string &filename = "",
+              TapeAdvice advice = TapeAdvice::NORMAL,
+              const PagePolicy &pages = PagePolicy())
+        : m_max_size(std::max<uint64_t>(max_size, 1)),
+          m_storage(units(initial_size()), filename, advice, pages),
+          m_size(initial_size()) {}
+
+    //! Units of the underlying storage, for contiguous storage policies.
+    Unit *data() { return m_storage.data(); }
+    const Unit *data() const { return m_storage.data(); }
+    //! Number of slots.
+    uint64_t size() const { return m_size; }
+    uint64_t max_size() const { return m_max_size; }
+    //! Direct access to a slot, for cell policies with one slot per unit.
+    Unit &operator[](uint64_t index) { return data()[index]; }
+
+    uint8_t get(uint64_t index) const {
+        return Cells::get(m_storage.load(index / Cells::PER_UNIT),
+                          index % Cells::PER_UNIT);
+    }
+    void set(uint64_t index, uint8_t value) {
+        auto unit = index / Cells::PER_UNIT;
+        m_storage.store(unit, Cells::set(m_storage.load(unit),
+                                         index % Cells::PER_UNIT, value));
+    }
+    /** Return the index one slot from `head` in `direction` (-1 or +1),
+     * growing or wrapping around the tape as needed.
+     * \warning Invalidates pointers returned by \ref data() if the tape grows.
+     */
+    uint64_t move(uint64_t head, int direction) {
+        head += direction;
+        // Moving left of slot 0 wraps around to a huge index, so one
+        // comparison catches both ends of the tape.
+        if (head >= m_size) {
+            head = direction < 0 ? extend_left() : extend_right();
+        }
+        return head;
+    }
+
+    /** Index the head starts at after \ref clear.
+     *
+     * This is the middle of the initial tape, so short runs do not grow the
+     * tape no matter which direction the head moves first.
+     */
+    uint64_t origin() const { return initial_size() / 2; }
+
+    /** Make room left of slot 0 and return the index of the slot there.
+     * \warning Invalidates pointers returned by \ref data().
+     */
+    uint64_t extend_left() {
+        auto old_size = m_size;
+        if (!Boundary::GROWS || old_size == m_max_size) {
+            return old_size - 1;
+        }
+        auto new_size = std::min(m_max_size, old_size * 2);
+        auto added = new_size - old_size;
+        if (added % Cells::PER_UNIT) {
+            // Only the last extension to max_size can end mid-unit. Every
+            // slot moves within its unit, so rewrite the whole tape.
+            auto slots = contents();
+            m_size = new_size;
+            m_storage.resize(units(m_size));
+            m_storage.clear();
+            for (uint64_t i = 0; i < slots.size(); i++) {
+                if (slots[i]) {
+                    set(added + i, slots[i]);
+                }
+            }
+        } else {
+            m_storage.shift_up(added / Cells::PER_UNIT);
+            m_size = new_size;
+        }
+        return added - 1;
+    }
+    /** Make room right of the last slot and return the index of the slot there.
+     * \warning Invalidates pointers returned by \ref data().
+     */
+    uint64_t extend_right() {
+        auto old_size = m_size;
+        if (!Boundary::GROWS || old_size == m_max_size) {
+            return 0;
+        }
+        m_size = std::min(m_max_size, old_size * 2);
+        m_storage.resize(units(m_size));
+        return old_size;
+    }
+
+    /** Set all slots to zero, and shrink back to the initial size.
+     *
+     * For growing tapes, this is proportional to the region the previous run
+     * visited: shrinking drops everything beyond the initial size, and only
+     * the initial page is zeroed.
+     */
+    void clear() {
+        if (m_size != initial_size()) {
+            m_size = initial_size();
+            m_storage.resize(units(m_size));
+        }
+        m_storage.clear();
+    }
+    //! Bytes the storage currently holds, see \ref MemoryUsage.
+    uint64_t reserved_bytes() const { return m_storage.reserved_bytes(); }
+    //! Part of \ref reserved_bytes backed by memory, see \ref MemoryUsage.
+    uint64_t touched_bytes() const { return m_storage.touched_bytes(); }
+    //! Bytes needed for the tape at \ref max_size, not counting overhead.
+    uint64_t maximum_bytes() const { return units(m_max_size) * sizeof(Unit); }
+
+    //! Sum of all slots.
+    uint64_t checksum() const {
+        uint64_t sum = 0;
+        for (uint64_t i = 0; i < units(m_size); i++) {
+            sum += Cells::sum(m_storage.load(i));
+        }
+        return sum;
+    }
+
+    //! Copy of all slots, one byte each.
+    std::vector<uint8_t> contents() const {
+        std::vector<uint8_t> result(m_size);
+        for (uint64_t i = 0; i < m_size; i++) {
+            result[i] = get(i);
+        }
+        return result;
+    }
+    /** Replace all slots with `contents`.
+     *
+     * Tapes that do not grow are padded with zero slots to \ref max_size, so
+     * snapshots can move between tapes of any policy.
+     * \throws std::runtime_error If `contents` is larger than \ref max_size.
+     */
+    void assign(const std::vector<uint8_t> &contents) {
+        if (contents.size() > m_max_size || contents.empty()) {
+            throw std::runtime_error("Tape contents do not fit the program.");
+        }
+        m_storage.resize(0);
+        m_size = Boundary::GROWS ? contents.size() : m_max_size;
+        m_storage.resize(units(m_size));
+        for (uint64_t i = 0; i < contents.size(); i++) {
+            if (contents[i]) {
+                set(i, contents[i]);
+            }
+        }
+    }
+
+  private:
+    uint64_t m_max_size;
+    Storage<Unit> m_storage;
+    uint64_t m_size;
+
+    //! Number of units holding `slots` slots.
+    static uint64_t units(uint64_t slots) {
+        return (slots + Cells::PER_UNIT - 1) / Cells::PER_UNIT;
+    }
+    uint64_t initial_size() const {
+        return Boundary::GROWS ? std::min(m_max_size, INITIAL_SIZE)
+                               : m_max_size;
+    }
+};
+
+/** The tape used by the default executors: one byte per slot, in memory
+ * that may be backed by a file, growing as the head moves.
+ * \ingroup execution
+ */
+typedef BasicTape<ByteCells, MmapStorage, GrowableBoundary> Tape;
+} // namespace day25
@@ -0,0 +1,82 @@
+#pragma once
+#include "page_allocator.hpp"
+#include <cstdint>
+#include <string>
+
+namespace day25 {
+/** Access pattern hint for the memory backing a tape.
+ * \ingroup execution
+ */
+enum class TapeAdvice {
+    //! Let the kernel decide.
+    NORMAL,
+    //! The head sweeps across the tape, read ahead aggressively.
+    SEQUENTIAL,
+    //! The head jumps around, do not read ahead.
+    RANDOM,
+};
+
+/**
+ * Owns the memory backing a tape.
+ *
+ * The memory is either anonymous, or a shared mapping of a sparse file. With
+ * a file, the kernel can page cold regions of very large tapes out to disk,
+ * and the tape stays on disk as a raw byte dump after the run. Anonymous
+ * memory is allocated according to a \ref PagePolicy.
+ * \ingroup execution
+ */
+class TapeMemory {
+  public:
+    /** Map `size` zeroed bytes.
+     * \param size Number of bytes.
+     * \param filename If non-empty, back the memory with this file. The file is
+     *                 created or truncated.
+     * \param advice Access pattern hint passed to the kernel.
+     * \param pages Page size and NUMA placement. Ignored for files.
+     * \throws std::runtime_error If the memory could not be mapped.
+     */
+    TapeMemory(uint64_t size, const std::string &filename = "",
+               TapeAdvice advice = TapeAdvice::NORMAL,
+               const PagePolicy &pages = PagePolicy());
+    ~TapeMemory();
+    TapeMemory(const TapeMemory &) = delete;
+    TapeMemory &operator=(const TapeMemory &) = delete;
+
+    uint8_t *data() const { return m_data; }
+    uint64_t size() const { return m_size; }
+    uint8_t &operator[](uint64_t index) { return m_data[index]; }
+    const uint8_t &operator[](uint64_t index) const { return m_data[index]; }
+
+    /** Number of bytes backed by physical memory (or the page cache, for
+     * files), in whole pages. Asks the kernel about every page.
+     */
+    uint64_t resident_size() const;
+
+    //! Set all bytes to zero. File-backed memory is turned back into a hole.
+    void clear();
+
+    /** Change the size to `size` bytes, keeping the contents up to the
+     * smaller of both sizes. Added bytes are zero.
+     * \warning Invalidates pointers returned by \ref data().
+     */
+    void resize(uint64_t size);
+
+  private:
+    uint8_t *m_data;
+    uint64_t m_size;
+    //! Bytes actually mapped; explicit huge pages round \ref m_size up.
+    uint64_t m_mapped;
+    //! Whether the memory is mapped with explicit huge pages.
+    bool m_huge;
+    /** Whether to move to explicit huge pages once the memory grows large
+     * enough. Cleared when the huge page pool turns out to be exhausted.
+     */
+    bool m_want_huge;
+    int m_fd;
+    TapeAdvice m_advice;
+    PagePolicy m_pages;
+
+    void advise();
+    void resize_huge(uint64_t size);
+};
+} // namespace day25
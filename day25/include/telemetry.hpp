@@ -0,0 +1,78 @@
+#pragma once
+#include "executor.hpp"
+#include "program.hpp"
+#include "run_handle.hpp"
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace day25 {
+/**
+ * Settings for \ref Telemetry.
+ * \ingroup execution
+ */
+struct TelemetryOptions {
+    //! If non-empty, rewrite this file with the current metrics every \ref interval.
+    std::string stats_file;
+    //! If non-empty, serve the current metrics over HTTP on a UNIX socket at this path.
+    std::string socket_path;
+    //! Time between two updates of \ref stats_file.
+    std::chrono::milliseconds interval{1000};
+};
+
+/**
+ * Exports the progress of a long run while it executes.
+ *
+ * The executor's thread calls \ref publish between two blocks of steps, e.g.
+ * from \ref RunOptions::on_progress, which only stores a few atomics. A
+ * background thread samples them, adds the resident set size of the process,
+ * and writes them in the Prometheus text format, to a stats file and/or to
+ * clients of a UNIX socket:
+ * \code
+ * curl --unix-socket day25.sock http://localhost/metrics
+ * \endcode
+ * \ingroup execution
+ */
+class Telemetry {
+  public:
+    /** Start the background thread.
+     * \param program The program being run, to name its states.
+     * \param options Where to export the metrics.
+     * \throws std::runtime_error If the socket could not be created.
+     */
+    Telemetry(const Program &program, const TelemetryOptions &options);
+    //! Write the stats file a last time and stop the background thread.
+    ~Telemetry();
+    Telemetry(const Telemetry &) = delete;
+    Telemetry &operator=(const Telemetry &) = delete;
+
+    /** Store the current metrics of `executor`. Call this on the thread
+     * running the executor, between two calls of \ref Executor::run.
+     */
+    void publish(const Executor &executor, const RunProgress &progress);
+    //! The most recently published metrics, in the Prometheus text format.
+    std::string render() const;
+
+  private:
+    TelemetryOptions m_options;
+    std::vector<std::string> m_state_names;
+    std::map<std::string, uint32_t> m_state_indexes;
+
+    std::atomic<uint64_t> m_steps{0};
+    std::atomic<double> m_steps_per_second{0};
+    std::atomic<uint32_t> m_state{0};
+    std::atomic<uint64_t> m_head{0};
+    std::atomic<uint64_t> m_tape_size{0};
+
+    int m_socket;
+    std::atomic<bool> m_stopping{false};
+    std::thread m_thread;
+
+    void sample_loop();
+    void write_stats_file() const;
+    void serve_client() const;
+};
+} // namespace day25
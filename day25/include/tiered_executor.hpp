@@ -0,0 +1,89 @@
+#pragma once
+#include "bytecode_executor.hpp"
+#include "executor.hpp"
+#include "jit_executor.hpp"
+#include "program.hpp"
+#include <atomic>
+#include <future>
+#include <memory>
+
+namespace day25 {
+/**
+ * Bytecode for a \ref Program, plus machine code that is compiled in the
+ * background, as run by \ref TieredExecutor.
+ * \ingroup execution
+ */
+class TieredProgram : public CompiledProgram {
+  public:
+    //! `pages` controls how the code buffer of the JIT tier is allocated.
+    TieredProgram(Program program, const PagePolicy &pages = PagePolicy());
+    virtual ~TieredProgram();
+    virtual std::shared_ptr<Executor>
+    instantiate(const ExecutorOptions &options = ExecutorOptions()) const;
+    //! The bytecode table, plus the machine code once it is ready.
+    virtual MemoryUsage memory_usage() const;
+
+    const std::shared_ptr<const BytecodeProgram> &bytecode() const {
+        return m_bytecode;
+    }
+    //! Whether compiling the machine code has finished, successfully or not.
+    bool jit_ready() const {
+        return m_jit_ready.load(std::memory_order_relaxed);
+    }
+    //! The machine code, or null if it is not ready or could not be compiled.
+    std::shared_ptr<const JitProgram> jit() const;
+
+  private:
+    std::shared_ptr<const BytecodeProgram> m_bytecode;
+    //! Set by the compiler thread when \ref m_jit has a result.
+    std::atomic<bool> m_jit_ready;
+    std::shared_future<std::shared_ptr<const JitProgram>> m_jit;
+};
+
+/** Starts running a \ref Program in a \ref BytecodeExecutor right away, and
+ * switches to a \ref JitExecutor once that has been compiled in the
+ * background.
+ *
+ * The switch happens between two steps and carries over tape, head, state and
+ * step count, so short runs do not wait for the compiler and long runs still
+ * spend most of their time in generated code. If compilation fails, the
+ * program keeps running in the bytecode tier. Executors sharing a
+ * \ref TieredProgram share its compiler run, too.
+ *
+ * With \ref ExecutorOptions::tape_file set, both tiers keep the tape in the
+ * file; the JIT tier recreates it from a snapshot at the switch.
+ * \ingroup execution
+ */
+class TieredExecutor : public virtual Executor {
+  public:
+    TieredExecutor(Program program,
+                   const ExecutorOptions &options = ExecutorOptions());
+    TieredExecutor(std::shared_ptr<const TieredProgram> compiled,
+                   const ExecutorOptions &options = ExecutorOptions());
+    virtual ~TieredExecutor();
+    virtual void step();
+    virtual void run(uint64_t steps);
+    virtual void reset();
+    virtual uint64_t diagnostic_checksum();
+    virtual uint64_t head() const;
+    virtual uint64_t tape_size() const;
+    virtual MemoryUsage memory_usage(bool measure_touched = true) const;
+    virtual std::string state() const;
+    virtual MachineState machine_state() const;
+    virtual void restore_machine_state(const MachineState &state);
+
+    //! Whether execution has switched to the JIT tier.
+    bool promoted() const { return m_jit != nullptr; }
+
+  private:
+    std::shared_ptr<const TieredProgram> m_compiled;
+    ExecutorOptions m_options;
+    std::unique_ptr<BytecodeExecutor> m_interpreter;
+    std::unique_ptr<JitExecutor> m_jit;
+    //! Cleared once compiling has failed.
+    bool m_promotable;
+    Executor *m_active;
+
+    void try_promote();
+};
+} // namespace day25
@@ -0,0 +1,40 @@
+#include "day25.hpp"
+#include "static_executor.hpp"
+#include <fstream>
+#include <iostream>
+
+/*
+ * Writes the header that embeds a program into a binary as executor
+ * static:<name>. Run at build time by the d25_embed_program CMake function.
+ **/
+
+using std::cerr;
+using std::cout;
+using std::endl;
+using std::ofstream;
+using std::string;
+using namespace day25;
+
+int usage(string cmd) {
+    auto last_slash = cmd.find_last_of('/');
+    if (last_slash != string::npos) {
+        cmd = cmd.substr(last_slash + 1);
+    }
+    cout << "Usage: " << cmd << " program name output.hpp" << endl;
+    return 1;
+}
+
+int main(int argc, char **argv) {
+    if (argc != 4) {
+        return usage(argv[0]);
+    }
+    auto program = load_file(argv[1]);
+    string output = argv[3];
+    ofstream file(output);
+    if (file.fail()) {
+        cerr << "Could not open " << output << endl;
+        return 1;
+    }
+    generate_static_spec(file, program, argv[2]);
+    return 0;
+}
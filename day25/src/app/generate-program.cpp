@@ -0,0 +1,74 @@
+#include "generator.hpp"
+#include <fstream>
+#include <iostream>
+
+/*
+ * Writes random, reproducible turing machine specifications, e.g. for testing
+ * how the executors scale with the number of states.
+ **/
+
+using std::cerr;
+using std::cout;
+using std::endl;
+using std::ofstream;
+using std::string;
+using namespace day25;
+
+int usage(string cmd) {
+    auto last_slash = cmd.find_last_of('/');
+    if (last_slash != string::npos) {
+        cmd = cmd.substr(last_slash + 1);
+    }
+    GeneratorOptions defaults;
+    cout << "Usage: " << cmd << " [options]" << endl
+         << endl
+         << "Options:" << endl
+         << "  --states n     Number of states (default " << defaults.states
+         << ")" << endl
+         << "  --steps n      Steps until the checksum (default "
+         << defaults.steps << ")" << endl
+         << "  --bias p       Probability of moving right (default "
+         << defaults.right_bias << ")" << endl
+         << "  --seed n       Random seed (default " << defaults.seed << ")"
+         << endl
+         << "  --output file  Write to file instead of stdout" << endl;
+    return 1;
+}
+
+int main(int argc, char **argv) {
+    GeneratorOptions options;
+    string output;
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        if (i + 1 >= argc) {
+            return usage(argv[0]);
+        }
+        string value = argv[++i];
+        if (arg == "--states") {
+            options.states = std::stoul(value);
+        } else if (arg == "--steps") {
+            options.steps = std::stoull(value);
+        } else if (arg == "--bias") {
+            options.right_bias = std::stod(value);
+        } else if (arg == "--seed") {
+            options.seed = std::stoull(value);
+        } else if (arg == "--output") {
+            output = value;
+        } else {
+            return usage(argv[0]);
+        }
+    }
+
+    auto program = generate_program(options);
+    if (output.empty()) {
+        write_program(cout, program);
+    } else {
+        ofstream file(output);
+        if (file.fail()) {
+            cerr << "Could not open " << output << endl;
+            return 1;
+        }
+        write_program(file, program);
+    }
+    return 0;
+}
@@ -1,7 +1,18 @@
+#include "c_generator.hpp"
 #include "day25.hpp"
+#include "jit_debug.hpp"
+#include "telemetry.hpp"
+#include <algorithm>
+#include <array>
+#include <chrono>
 #include <fstream>
+#include <future>
+#include <memory>
 #include <iostream>
 #include <numeric>
+#include <set>
+#include <stdexcept>
+#include <unordered_map>
 
 using std::cout;
 using std::endl;
@@ -16,7 +27,27 @@ using namespace day25;
 struct Arguments {
     string program;
     string executor;
-    enum { NONE, RUN, BENCHMARK, GENERATE_C } action;
+    enum { NONE, RUN, BENCHMARK, PGO, GENERATE_C, CHECK } action;
+    //! Write checkpoints of the running machine to this file (run only).
+    string checkpoint_file;
+    //! Number of steps between two checkpoints.
+    uint64_t checkpoint_interval = 100000000;
+    //! Continue a run from this checkpoint instead of starting over.
+    string resume_file;
+    //! Stop the run after this many seconds of wall-clock time (0: no limit).
+    double time_limit = 0;
+    //! Stop the run before the executor holds more than this many bytes (0: no limit).
+    uint64_t memory_limit = 0;
+    //! Write how often each action was taken to this file (run only).
+    string coverage_file;
+    //! Where to export live metrics of the run, if anywhere.
+    TelemetryOptions telemetry_options;
+    ExecutorOptions executor_options;
+    //! \ref JitDebugInfo flags for generated code.
+    unsigned jit_debug = JIT_DEBUG_NONE;
+    //! Output file for generate-c. The header is written next to it.
+    string c_output = "generated-program.c";
+    CGeneratorOptions c_options;
 };
 
 int usage(string cmd) {
@@ -24,40 +55,204 @@ int usage(string cmd) {
     if (last_slash != string::npos) {
         cmd = cmd.substr(last_slash + 1);
     }
-    cout << "Usage: " << cmd << " run program executor" << endl
-         << "   or: " << cmd << " benchmark program [executor]" << endl
-         << "   or: " << cmd << " generate-c program" << endl
+    cout << "Usage: " << cmd << " run program executor [options]" << endl
+         << "   or: " << cmd << " benchmark program [executor] [options]"
+         << endl
+         << "   or: " << cmd << " pgo program" << endl
+         << "   or: " << cmd << " check program [executor]" << endl
+         << "   or: " << cmd << " generate-c program [options]" << endl
+         << endl
+         << "Options for run:" << endl
+         << "  --checkpoint file       Periodically save the machine state."
+         << endl
+         << "  --checkpoint-every n    Steps between checkpoints." << endl
+         << "  --resume file           Continue from a saved checkpoint."
+         << endl
+         << "  --time-limit s          Stop after s seconds (exit code 2)."
+         << endl
+         << "  --memory-limit MiB      Stop before exceeding this much memory"
+         << endl
+         << "                          (exit code 3)." << endl
+         << "  --stats-file file       Write live metrics to file." << endl
+         << "  --stats-socket path     Serve live metrics on a UNIX socket."
+         << endl
+         << "  --stats-interval s      Seconds between stats file updates."
+         << endl
+         << "  --coverage file         Write how often each action was taken."
+         << endl
+         << "  --stop-state S          Stop on entering state S (exit code 4)."
+         << endl
+         << "  --stop-head-min n       Stop when the head moves left of n."
+         << endl
+         << "  --stop-head-max n       Stop when the head moves right of n."
+         << endl
+         << "  --stop-every n          Stop after every n steps." << endl
+         << "  --stop-checksum n       Stop when the checksum exceeds n."
+         << endl
+         << endl
+         << "Options for run and benchmark:" << endl
+         << "  --tape-file file        Keep the tape in a memory-mapped file."
+         << endl
+         << "  --tape-advice hint      normal, sequential or random." << endl
+         << "  --huge-pages mode       none, transparent or explicit, for the"
+         << endl
+         << "                          tape and generated code." << endl
+         << "  --numa-node n           Prefer memory on NUMA node n." << endl
+         << "  --jit-debug tools       none, perf, gdb or perf,gdb: publish"
+         << endl
+         << "                          symbols of generated code." << endl
+         << endl
+         << "Options for generate-c:" << endl
+         << "  --output file.c         Write to file.c and file.h." << endl
+         << "  --mode mode             benchmark (with main) or library."
+         << endl
+         << "  --prefix name           Prefix for generated names." << endl
          << endl
          << "Available executors: " << endl;
     for (auto it : list_executors()) {
         cout << " * " << it << endl;
     }
+    cout << endl
+         << "ast and bytecode also run on other tapes, selected as" << endl
+         << "executor:cells:storage:boundary with cells bit, byte or u16,"
+         << endl
+         << "storage flat, chunked or mmap and boundary growable or circular,"
+         << endl
+         << "e.g. bytecode:bit:chunked:growable." << endl;
     return 1;
 }
 
+//! Options listed under "Options for run", besides the --stop-* options.
+const std::set<string> RUN_ONLY_OPTIONS = {
+    "--checkpoint",   "--checkpoint-every", "--resume",
+    "--time-limit",   "--memory-limit",     "--stats-file",
+    "--stats-socket", "--stats-interval",   "--coverage",
+};
+
 Arguments parse_args(int argc, char **argv) {
     Arguments result;
     if (argc < 2) {
         return result;
     }
 
+    int position = 0;
     for (int i = 1; i < argc; i++) {
         string arg = argv[i];
-        if (i == 1) {
+        if (arg.rfind("--", 0) == 0) {
+            bool generating = result.action == Arguments::GENERATE_C;
+            bool running = result.action == Arguments::RUN ||
+                           result.action == Arguments::BENCHMARK;
+            if (i + 1 >= argc || (!generating && !running)) {
+                result.action = Arguments::NONE;
+                return result;
+            }
+            string value = argv[++i];
+            if (generating) {
+                if (arg == "--output") {
+                    result.c_output = value;
+                } else if (arg == "--mode" && value == "benchmark") {
+                    result.c_options.benchmark_harness = true;
+                } else if (arg == "--mode" && value == "library") {
+                    result.c_options.benchmark_harness = false;
+                } else if (arg == "--prefix") {
+                    result.c_options.prefix = value;
+                } else {
+                    result.action = Arguments::NONE;
+                    return result;
+                }
+            } else if (result.action != Arguments::RUN &&
+                       (RUN_ONLY_OPTIONS.count(arg) ||
+                        arg.rfind("--stop-", 0) == 0)) {
+                // Benchmarks always run full blocks of steps from the start.
+                result.action = Arguments::NONE;
+                return result;
+            } else if (arg == "--checkpoint") {
+                result.checkpoint_file = value;
+            } else if (arg == "--checkpoint-every") {
+                result.checkpoint_interval = std::stoull(value);
+                if (!result.checkpoint_interval) {
+                    result.action = Arguments::NONE;
+                    return result;
+                }
+            } else if (arg == "--resume") {
+                result.resume_file = value;
+            } else if (arg == "--time-limit") {
+                result.time_limit = std::stod(value);
+            } else if (arg == "--memory-limit") {
+                result.memory_limit = std::stod(value) * 1024 * 1024;
+            } else if (arg == "--coverage") {
+                result.coverage_file = value;
+            } else if (arg == "--stop-state") {
+                result.executor_options.stop.state = value;
+            } else if (arg == "--stop-head-min") {
+                result.executor_options.stop.head_min = std::stoll(value);
+            } else if (arg == "--stop-head-max") {
+                result.executor_options.stop.head_max = std::stoll(value);
+            } else if (arg == "--stop-every") {
+                result.executor_options.stop.step_multiple = std::stoull(value);
+            } else if (arg == "--stop-checksum") {
+                result.executor_options.stop.checksum_limit = std::stoull(value);
+            } else if (arg == "--stats-file") {
+                result.telemetry_options.stats_file = value;
+            } else if (arg == "--stats-socket") {
+                result.telemetry_options.socket_path = value;
+            } else if (arg == "--stats-interval") {
+                result.telemetry_options.interval =
+                    std::chrono::milliseconds((int64_t)(std::stod(value) * 1000));
+            } else if (arg == "--tape-file") {
+                result.executor_options.tape_file = value;
+            } else if (arg == "--tape-advice" && value == "normal") {
+                result.executor_options.tape_advice = TapeAdvice::NORMAL;
+            } else if (arg == "--tape-advice" && value == "sequential") {
+                result.executor_options.tape_advice = TapeAdvice::SEQUENTIAL;
+            } else if (arg == "--tape-advice" && value == "random") {
+                result.executor_options.tape_advice = TapeAdvice::RANDOM;
+            } else if (arg == "--huge-pages" && value == "none") {
+                result.executor_options.pages.huge_pages = HugePages::NONE;
+            } else if (arg == "--huge-pages" && value == "transparent") {
+                result.executor_options.pages.huge_pages =
+                    HugePages::TRANSPARENT;
+            } else if (arg == "--huge-pages" && value == "explicit") {
+                result.executor_options.pages.huge_pages = HugePages::EXPLICIT;
+            } else if (arg == "--numa-node") {
+                result.executor_options.pages.numa_node = std::stoi(value);
+            } else if (arg == "--jit-debug" && value == "none") {
+                result.jit_debug = JIT_DEBUG_NONE;
+            } else if (arg == "--jit-debug" && value == "perf") {
+                result.jit_debug = JIT_DEBUG_PERF_MAP;
+            } else if (arg == "--jit-debug" && value == "gdb") {
+                result.jit_debug = JIT_DEBUG_GDB;
+            } else if (arg == "--jit-debug" &&
+                       (value == "perf,gdb" || value == "gdb,perf")) {
+                result.jit_debug = JIT_DEBUG_PERF_MAP | JIT_DEBUG_GDB;
+            } else {
+                result.action = Arguments::NONE;
+                return result;
+            }
+            continue;
+        }
+
+        position++;
+        if (position == 1) {
             if (arg == "run") {
                 result.action = Arguments::RUN;
             } else if (arg == "generate-c") {
                 result.action = Arguments::GENERATE_C;
             } else if (arg == "benchmark") {
                 result.action = Arguments::BENCHMARK;
+            } else if (arg == "pgo") {
+                result.action = Arguments::PGO;
+            } else if (arg == "check") {
+                result.action = Arguments::CHECK;
             } else {
                 return result;
             }
-        } else if (i == 2) {
+        } else if (position == 2) {
             result.program = arg;
-        } else if (i == 3 && (result.action == Arguments::RUN ||
-                              result.action == Arguments::BENCHMARK)) {
-            auto executors = list_executors();
+        } else if (position == 3 && (result.action == Arguments::RUN ||
+                              result.action == Arguments::BENCHMARK ||
+                              result.action == Arguments::CHECK)) {
+            auto executors = list_executors(true);
             if (find(executors.begin(), executors.end(), arg) !=
                 executors.end()) {
                 result.executor = arg;
@@ -74,83 +269,161 @@ Arguments parse_args(int argc, char **argv) {
     return result;
 }
 
-int generate_c(Program program, ostream &cfile) {
-    map<string, int> state_map;
-    for (auto state : program.states) {
-        state_map[state.first] = state_map.size();
-    }
-
-    cfile << "#include <time.h>" << endl;
-    cfile << "#include <stdio.h>" << endl;
-    cfile << "#include <string.h>" << endl;
-    cfile << "char tape[" << program.checksum_delay << "];" << endl;
-
-    cfile << "void run() {" << endl;
-    cfile << "  unsigned current_state = " << state_map[program.initial_state]
-          << ";" << endl;
-    cfile << "  unsigned long current_offset = 0;" << endl;
-    cfile << "  for (unsigned long steps = 0; steps < "
-          << program.checksum_delay << "; steps++) {" << endl;
-    cfile << "    switch(current_state) {" << endl;
-    for (auto state : program.states) {
-        cfile << "      case " << state_map[state.first] << ":" << endl;
-        cfile << "        if (tape[current_offset] == 0) {" << endl;
-        cfile << "          tape[current_offset] = "
-              << state.second.actions[0].write_value << ";" << endl;
-        cfile << "          current_offset = (current_offset + sizeof(tape) + "
-              << state.second.actions[0].move_direction << ") % sizeof(tape);"
-              << endl;
-        cfile << "          current_state = "
-              << state_map[state.second.actions[0].next_state] << ";" << endl;
-        cfile << "        } else {" << endl;
-        cfile << "          tape[current_offset] = "
-              << state.second.actions[1].write_value << ";" << endl;
-        cfile << "          current_offset = (current_offset + sizeof(tape) + "
-              << state.second.actions[1].move_direction << ") % sizeof(tape);"
-              << endl;
-        cfile << "          current_state = "
-              << state_map[state.second.actions[1].next_state] << ";" << endl;
-        cfile << "        }" << endl;
-        cfile << "        break;" << endl;
-    }
-    cfile << "    } //switch" << endl;
-    cfile << "  } //for" << endl;
-    cfile << "}; //run" << endl;
-    cfile << "int main() {" << endl;
-    cfile << "  //Benchmark:" << endl;
-    cfile << "  clock_t start_ts = clock();" << endl;
-    cfile << "  for (int i=0; i<25; i++) {" << endl;
-    cfile << "    run();" << endl;
-    cfile << "  }" << endl;
-    cfile << "  clock_t end_ts = clock();" << endl;
-    cfile << "  double duration = end_ts - start_ts;" << endl;
-    cfile << "  duration /= CLOCKS_PER_SEC;" << endl;
-    cfile << "  duration *= 1000;" << endl;
-    cfile << R"(  printf("Time per iteration: %lfms\n", duration/25);)" << endl;
-    cfile << R"(  printf("Total executed steps: )"
-          << program.checksum_delay * 25 << R"(\n");)" << endl;
-    cfile << "  printf(\"%lf steps/ms\\n%lf us/step\\n\", "
-          << program.checksum_delay * 25 << "/ duration, 1000 * duration / "
-          << program.checksum_delay * 25 << ");" << endl;
-    cfile << "//Actual execution:" << endl;
-    cfile << "    memset(tape, 0, sizeof(tape));" << endl;
-    cfile << "    run();" << endl;
-    cfile << "  unsigned checksum = 0;" << endl;
-    cfile << "  for (unsigned long i=0; i<sizeof(tape); i++) {" << endl;
-    cfile << "    checksum += tape[i];" << endl;
-    cfile << "  } //for" << endl;
-    cfile << R"(  printf("Checksum: %i\n", checksum);)" << endl;
-    cfile << "  return 0;" << endl;
-    cfile << "} //main" << endl;
+int generate_c(Program program, const Arguments &args) {
+    auto source_name = args.c_output;
+    auto base_name = source_name;
+    if (base_name.size() > 2 &&
+        base_name.compare(base_name.size() - 2, 2, ".c") == 0) {
+        base_name.resize(base_name.size() - 2);
+    }
+    auto header_name = base_name + ".h";
+    // The source includes the header by its name relative to the source.
+    auto header_include = header_name.substr(header_name.find_last_of('/') + 1);
+
+    ofstream header_file(header_name);
+    ofstream source_file(source_name);
+    if (header_file.fail() || source_file.fail()) {
+        cout << "Could not open " << source_name << " or " << header_name
+             << endl;
+        return 1;
+    }
+    cout << "Writing program to files " << source_name << " and "
+         << header_name << endl;
+    generate_c_header(header_file, program, args.c_options);
+    generate_c_source(source_file, program, header_include, args.c_options);
     return 0;
 }
 
-int run(Program program, const string &executor_name) {
-    auto executor = get_executor(executor_name, program);
+//! Counts how often each action of each state is taken, for --coverage.
+class CoverageObserver : public Observer {
+  public:
+    void write(uint64_t, uint8_t old_value, uint8_t) override {
+        m_slot = old_value;
+    }
+    void transition(const string &from, const string &) override {
+        m_counts[from][m_slot]++;
+    }
+    //! Write one line "state value count" per action, and summarize it.
+    void write_report(const Program &program, const string &filename) {
+        ofstream file(filename);
+        uint64_t taken = 0;
+        for (auto &it : program.states) {
+            auto &counts = m_counts[it.first];
+            for (unsigned slot = 0; slot <= 1; slot++) {
+                file << it.first << " " << slot << " " << counts[slot] << endl;
+                taken += counts[slot] > 0;
+            }
+        }
+        cout << "Coverage: " << taken << " of " << 2 * program.states.size()
+             << " actions taken, written to " << filename << endl;
+    }
+
+  private:
+    uint8_t m_slot = 0;
+    std::unordered_map<string, std::array<uint64_t, 2>> m_counts;
+};
+
+int run(Program program, const Arguments &args) {
+    auto executor_options = args.executor_options;
+    CoverageObserver coverage;
+    if (!args.coverage_file.empty()) {
+        executor_options.observer = &coverage;
+    }
+    std::shared_ptr<Executor> executor;
+    try {
+        executor = get_executor(args.executor, program, executor_options);
+    } catch (const std::runtime_error &e) {
+        // E.g. an executor without observer support for --coverage.
+        cout << "Cannot run with executor " << args.executor << ": "
+             << e.what() << endl;
+        return 1;
+    }
+    if (!args.resume_file.empty()) {
+        executor->load_checkpoint(args.resume_file);
+        cout << "Resuming after " << executor->steps_executed() << " steps."
+             << endl;
+    }
+    RunOptions run_options;
+    if (args.time_limit > 0) {
+        run_options.deadline =
+            RunOptions::Clock::now() +
+            std::chrono::duration_cast<RunOptions::Clock::duration>(
+                std::chrono::duration<double>(args.time_limit));
+    }
+    run_options.memory_limit = args.memory_limit;
+    std::unique_ptr<Telemetry> telemetry;
+    if (!args.telemetry_options.stats_file.empty() ||
+        !args.telemetry_options.socket_path.empty()) {
+        telemetry.reset(new Telemetry(program, args.telemetry_options));
+        telemetry->publish(*executor, RunProgress{});
+        // Runs on the executor's thread after every check interval:
+        run_options.on_progress = [&](const RunProgress &progress) {
+            telemetry->publish(*executor, progress);
+        };
+    }
+    auto result = RunResult::COMPLETED;
     cout << "Executing program." << endl;
     clock_t start_ts = clock();
-    for (int i = 0; i < program.checksum_delay; i++) {
-        executor->step();
+    if (args.checkpoint_file.empty()) {
+        result = executor
+                     ->run_async(program.checksum_delay -
+                                     executor->steps_executed(),
+                                 run_options)
+                     .wait();
+    } else {
+        // Only the snapshot is taken on this thread. Compressing and writing
+        // happens in the background; if the previous checkpoint is still
+        // being written, this one is skipped instead of waiting for it.
+        std::future<void> writer;
+        while (executor->steps_executed() < program.checksum_delay) {
+            auto block = std::min<uint64_t>(
+                args.checkpoint_interval,
+                program.checksum_delay - executor->steps_executed());
+            result = executor->run_async(block, run_options).wait();
+            if (result != RunResult::COMPLETED) {
+                break;
+            }
+            if (writer.valid() && writer.wait_for(std::chrono::seconds(0)) !=
+                                      std::future_status::ready) {
+                continue;
+            }
+            if (writer.valid()) {
+                writer.get();
+            }
+            writer = std::async(
+                std::launch::async,
+                [&args](MachineState snapshot) {
+                    Executor::save_checkpoint(args.checkpoint_file, snapshot);
+                },
+                executor->machine_state());
+        }
+        if (writer.valid()) {
+            writer.get();
+        }
+    }
+    if (result == RunResult::STOPPED) {
+        auto event = executor->stop_event();
+        cout << "Stopped by " << stop_reason_name(event.reason)
+             << " condition after " << event.step << " steps, in state "
+             << executor->state() << "." << endl;
+        cout << "Diagnostic checksum: " << executor->diagnostic_checksum()
+             << endl;
+        if (!args.checkpoint_file.empty()) {
+            executor->save_checkpoint(args.checkpoint_file);
+            cout << "Checkpoint written to " << args.checkpoint_file << endl;
+        }
+        return 4;
+    }
+    if (result != RunResult::COMPLETED) {
+        cout << (result == RunResult::MEMORY_LIMIT_EXCEEDED ? "Memory"
+                                                            : "Time")
+             << " limit reached after " << executor->steps_executed()
+             << " steps." << endl;
+        if (!args.checkpoint_file.empty()) {
+            executor->save_checkpoint(args.checkpoint_file);
+            cout << "Checkpoint written to " << args.checkpoint_file << endl;
+        }
+        return result == RunResult::MEMORY_LIMIT_EXCEEDED ? 3 : 2;
     }
     clock_t end_ts = clock();
     double duration = end_ts - start_ts;
@@ -158,11 +431,22 @@ int run(Program program, const string &executor_name) {
     duration /= CLOCKS_PER_SEC;
     cout << "Finished after " << duration << "ms" << endl;
     cout << "Diagnostic checksum: " << executor->diagnostic_checksum() << endl;
+    auto memory = executor->memory_usage();
+    cout << "Memory: tape " << memory.tape_reserved << " bytes ("
+         << memory.tape_touched << " touched), code " << memory.code_used
+         << "/" << memory.code_reserved << " bytes, tables " << memory.tables
+         << " bytes" << endl;
+    if (!args.executor_options.tape_file.empty()) {
+        cout << "Tape left in " << args.executor_options.tape_file << endl;
+    }
+    if (!args.coverage_file.empty()) {
+        coverage.write_report(program, args.coverage_file);
+    }
     return 0;
 }
 
 int benchmark(Program program, const string &executor_name,
-              const string indent = "") {
+              const ExecutorOptions &options, const string indent = "") {
     unsigned target_seconds = 20;
     auto target_clocks = CLOCKS_PER_SEC * target_seconds;
 
@@ -170,17 +454,28 @@ int benchmark(Program program, const string &executor_name,
         int result = 0;
         cout << indent << "Benchmarking program with all executors..." << endl;
         for (auto name : list_executors()) {
-            result |= benchmark(program, name, "    ");
+            if (name.rfind("static:", 0) == 0) {
+                // Embedded executors only run the program they were built for.
+                try {
+                    compile_program(name, program);
+                } catch (const std::runtime_error &e) {
+                    cout << "    Skipping " << name << ": " << e.what()
+                         << endl
+                         << endl;
+                    continue;
+                }
+            }
+            result |= benchmark(program, name, options, "    ");
             cout << endl;
         }
         return result;
     } else {
         cout << indent << "Benchmarking with executor " << executor_name
              << " for " << target_seconds << " seconds." << endl;
-        auto executor = get_executor(executor_name, program);
+        auto executor = get_executor(executor_name, program, options);
 
-        uint32_t iterations_per_block = 100000;
-        uint32_t blocks_executed = 0;
+        uint64_t iterations_per_block = 100000;
+        uint64_t blocks_executed = 0;
         auto start_ts = clock();
         auto target_ts = start_ts + target_clocks;
 
@@ -189,9 +484,7 @@ int benchmark(Program program, const string &executor_name,
             if (now > target_ts) {
                 break;
             }
-            for (uint32_t i = 0; i < iterations_per_block; i++) {
-                executor->step();
-            }
+            executor->run(iterations_per_block);
             blocks_executed++;
         }
         auto end_ts = clock();
@@ -208,6 +501,96 @@ int benchmark(Program program, const string &executor_name,
     }
 }
 
+double elapsed_ms(clock_t start_ts) {
+    double duration = clock() - start_ts;
+    return duration * 1000 / CLOCKS_PER_SEC;
+}
+
+int compare_pgo(Program program) {
+    cout << "Compiling with default layout." << endl;
+    auto start_ts = clock();
+    auto plain = get_executor("jit", program);
+    cout << "  took " << elapsed_ms(start_ts) << "ms" << endl;
+    cout << "Profiling and compiling with profile-guided layout." << endl;
+    start_ts = clock();
+    auto optimized = get_executor("jit-pgo", program);
+    cout << "  took " << elapsed_ms(start_ts) << "ms" << endl;
+
+    cout << "Running with default layout." << endl;
+    start_ts = clock();
+    plain->run(program.checksum_delay);
+    auto plain_ms = elapsed_ms(start_ts);
+    cout << "  took " << plain_ms << "ms" << endl;
+    cout << "Running with profile-guided layout." << endl;
+    start_ts = clock();
+    optimized->run(program.checksum_delay);
+    auto optimized_ms = elapsed_ms(start_ts);
+    cout << "  took " << optimized_ms << "ms" << endl;
+
+    if (plain->diagnostic_checksum() != optimized->diagnostic_checksum()) {
+        cout << "Checksums differ: " << plain->diagnostic_checksum()
+             << " != " << optimized->diagnostic_checksum() << endl;
+        return 1;
+    }
+    cout << "Diagnostic checksum: " << optimized->diagnostic_checksum() << endl;
+    cout << "Speedup: " << plain_ms / optimized_ms << "x" << endl;
+    return 0;
+}
+
+/** Steps between two comparisons in check. A prime, so comparisons fall on
+ * all step counts modulo the slots per storage unit.
+ */
+const uint64_t CHECK_BLOCK = 99991;
+
+int check(Program program, const string &executor_name) {
+    auto names = executor_name.empty() ? list_executors(true)
+                                       : std::list<string>{executor_name};
+    std::vector<std::pair<string, std::shared_ptr<Executor>>> executors;
+    for (auto &name : names) {
+        if (name == "bytecode") {
+            continue;
+        }
+        try {
+            executors.emplace_back(name, get_executor(name, program));
+        } catch (const std::runtime_error &e) {
+            // E.g. embedded executors for other programs.
+            cout << "Skipping " << name << ": " << e.what() << endl;
+        }
+    }
+    auto reference = get_executor("bytecode", program);
+    int mismatches = 0;
+    cout << "Comparing " << executors.size() << " executors with bytecode."
+         << endl;
+    while (reference->steps_executed() < program.checksum_delay) {
+        auto block = std::min(CHECK_BLOCK, program.checksum_delay -
+                                               reference->steps_executed());
+        reference->run(block);
+        for (auto it = executors.begin(); it != executors.end();) {
+            auto &executor = it->second;
+            executor->run(block);
+            if (executor->diagnostic_checksum() ==
+                    reference->diagnostic_checksum() &&
+                executor->state() == reference->state() &&
+                executor->steps_executed() == reference->steps_executed()) {
+                ++it;
+                continue;
+            }
+            cout << it->first << " differs after "
+                 << reference->steps_executed() << " steps: checksum "
+                 << executor->diagnostic_checksum() << " (expected "
+                 << reference->diagnostic_checksum() << "), state "
+                 << executor->state() << " (expected " << reference->state()
+                 << ")." << endl;
+            mismatches++;
+            it = executors.erase(it);
+        }
+    }
+    cout << executors.size() << " executors agree with bytecode after "
+         << reference->steps_executed() << " steps, " << mismatches
+         << " differ." << endl;
+    return mismatches ? 1 : 0;
+}
+
 int main(int argc, char **argv) {
     auto args = parse_args(argc, argv);
     if (args.action == Arguments::NONE) {
@@ -220,17 +603,18 @@ int main(int argc, char **argv) {
     }
 
     auto program = load_file(args.program);
+    set_jit_debug_info(args.jit_debug);
 
     if (args.action == Arguments::RUN) {
-        return run(program, args.executor);
+        return run(program, args);
     } else if (args.action == Arguments::GENERATE_C) {
-        string out_name = "generated-program.c";
-        ofstream out_file;
-        out_file.open(out_name);
-        cout << "Writing program to file " << out_name << endl;
-        return generate_c(program, out_file);
+        return generate_c(program, args);
     } else if (args.action == Arguments::BENCHMARK) {
-        return benchmark(program, args.executor);
+        return benchmark(program, args.executor, args.executor_options);
+    } else if (args.action == Arguments::PGO) {
+        return compare_pgo(program);
+    } else if (args.action == Arguments::CHECK) {
+        return check(program, args.executor);
     }
 
     return 0;
@@ -0,0 +1,243 @@
+#include "bytecode_executor.hpp"
+#include "day25.hpp"
+#include "jit_executor.hpp"
+#include "parser.hpp"
+#include "tokenizer.hpp"
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+
+/*
+ * Isolated microbenchmarks for each stage between reading a program and
+ * running it, so that regressions in startup-critical stages show up
+ * separately from steady-state throughput.
+ **/
+
+using std::cout;
+using std::endl;
+using std::setw;
+using std::shared_ptr;
+using std::string;
+using namespace day25;
+typedef std::chrono::steady_clock Clock;
+
+struct Arguments {
+    string program = "real-input";
+    string filter;
+    double min_seconds = 0.2;
+    //! Also benchmark the executors for other tape policies.
+    bool all_executors = false;
+};
+
+Arguments args;
+
+/** Time `op` until at least `args.min_seconds` have been spent in it.
+ *
+ * `setup` runs before each call of `op` and is not included in the timing.
+ * Prints the mean and minimum time per operation, where one call of `op`
+ * performs `ops_per_call` operations.
+ */
+template <class Setup, class Op>
+void measure(const string &name, Setup setup, Op op,
+             uint64_t ops_per_call = 1) {
+    if (name.find(args.filter) == string::npos) {
+        return;
+    }
+    std::chrono::duration<double, std::nano> total(0);
+    std::chrono::duration<double, std::nano> best(0);
+    uint64_t calls = 0;
+    while (total.count() < args.min_seconds * 1e9) {
+        setup();
+        auto start = Clock::now();
+        op();
+        auto end = Clock::now();
+        auto elapsed = end - start;
+        total += elapsed;
+        if (calls == 0 || elapsed < best) {
+            best = elapsed;
+        }
+        calls++;
+    }
+    cout << std::left << setw(48) << name << std::right << setw(12) << calls
+         << setw(14) << total.count() / calls / ops_per_call << setw(14)
+         << best.count() / ops_per_call << endl;
+}
+
+template <class Op>
+void measure(const string &name, Op op, uint64_t ops_per_call = 1) {
+    measure(name, [] {}, op, ops_per_call);
+}
+
+int usage(string cmd) {
+    auto last_slash = cmd.find_last_of('/');
+    if (last_slash != string::npos) {
+        cmd = cmd.substr(last_slash + 1);
+    }
+    cout << "Usage: " << cmd << " [program] [options]" << endl
+         << endl
+         << "Options:" << endl
+         << "  --filter text      Only run benchmarks containing text" << endl
+         << "  --min-time s       Time to spend per benchmark (default 0.2)"
+         << endl
+         << "  --executors set    main (default) or all, including every"
+         << endl
+         << "                     tape policy variant" << endl;
+    return 1;
+}
+
+int main(int argc, char **argv) {
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        if (arg.rfind("--", 0) != 0) {
+            args.program = arg;
+            continue;
+        }
+        if (i + 1 >= argc) {
+            return usage(argv[0]);
+        }
+        string value = argv[++i];
+        if (arg == "--filter") {
+            args.filter = value;
+        } else if (arg == "--min-time") {
+            args.min_seconds = std::stod(value);
+        } else if (arg == "--executors" && (value == "main" || value == "all")) {
+            args.all_executors = value == "all";
+        } else {
+            return usage(argv[0]);
+        }
+    }
+
+    string source;
+    {
+        std::ifstream file(args.program);
+        if (file.fail()) {
+            cout << "Could not open " << args.program << endl;
+            return usage(argv[0]);
+        }
+        std::stringstream buffer;
+        buffer << file.rdbuf();
+        source = buffer.str();
+    }
+    auto program = load_string(source);
+    // Executors allocate and clear the initial part of their tape when they
+    // are created. Use a single slot when measuring construction, so only
+    // the compilation is timed; tape costs are covered by the reset benchmarks.
+    auto tapeless_program = program;
+    tapeless_program.checksum_delay = 1;
+
+    cout << std::left << setw(48) << "benchmark" << std::right << setw(12)
+         << "iterations" << setw(14) << "mean ns/op" << setw(14)
+         << "min ns/op" << endl;
+
+    // Parsing:
+    uint64_t tokens = 0;
+    {
+        std::istringstream iss(source);
+        Tokenizer tokenizer(iss);
+        while (tokenizer.next().type != Token::END_OF_STREAM) {
+            tokens++;
+        }
+    }
+    std::istringstream token_stream;
+    measure(
+        "Tokenizer::next",
+        [&] {
+            token_stream.clear();
+            token_stream.str(source);
+        },
+        [&] {
+            Tokenizer tokenizer(token_stream);
+            while (tokenizer.next().type != Token::END_OF_STREAM) {
+            }
+        },
+        tokens + 1);
+
+    std::istringstream parser_stream;
+    measure(
+        "Parser::parse",
+        [&] {
+            parser_stream.clear();
+            parser_stream.str(source);
+        },
+        [&] {
+            Tokenizer tokenizer(parser_stream);
+            Parser parser(tokenizer);
+            parser.parse();
+        });
+
+    // Compilation:
+    measure("BytecodeExecutor construction",
+            [&] { BytecodeExecutor executor(tapeless_program); });
+
+    std::unique_ptr<Jit> jit;
+    auto create_jit = [&] { jit.reset(new Jit(jit_code_size(program))); };
+    measure("JitExecutor::compile", create_jit,
+            [&] { emit_program(jit.get(), program); });
+    measure(
+        "Jit::finalize_code",
+        [&] {
+            create_jit();
+            emit_program(jit.get(), program);
+        },
+        [&] { jit->finalize_code(); });
+    jit.reset();
+
+    // Replacing the initial state, alternating between two versions of it, so
+    // the cost includes recompiling once the code buffer fills up.
+    JitProgram patched_program(tapeless_program);
+    std::vector<State> patches[2];
+    patches[0].push_back(program.states.at(program.initial_state));
+    patches[1] = patches[0];
+    patches[1][0].actions.at(0).write_value ^= 1;
+    uint64_t patch_count = 0;
+    measure("JitProgram::patch_states", [&] {
+        patched_program.patch_states(patches[patch_count++ % 2]);
+    });
+
+    // Execution:
+    uint64_t steps_per_call = 1000;
+    for (auto name : list_executors(args.all_executors)) {
+        shared_ptr<const CompiledProgram> compiled;
+        try {
+            compiled = compile_program(name, program);
+        } catch (const std::runtime_error &e) {
+            // Embedded executors only run the program they were built for.
+            cout << "skipping " << name << ": " << e.what() << endl;
+            continue;
+        }
+        measure(name + " instantiate()", [&] { compiled->instantiate(); });
+        auto executor = compiled->instantiate();
+        measure(
+            name + " step()",
+            [&] {
+                if (executor->steps_executed() + steps_per_call >
+                    program.checksum_delay) {
+                    executor->reset();
+                }
+            },
+            [&] {
+                for (uint64_t i = 0; i < steps_per_call; i++) {
+                    executor->step();
+                }
+            },
+            steps_per_call);
+        measure(
+            name + " run()",
+            [&] {
+                if (executor->steps_executed() + steps_per_call >
+                    program.checksum_delay) {
+                    executor->reset();
+                }
+            },
+            [&] { executor->run(steps_per_call); }, steps_per_call);
+        measure(name + " reset()", [&] { executor->reset(); });
+        measure(name + " diagnostic_checksum()",
+                [&] { executor->diagnostic_checksum(); });
+    }
+    return 0;
+}
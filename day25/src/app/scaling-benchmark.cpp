@@ -0,0 +1,196 @@
+#include "day25.hpp"
+#include "generator.hpp"
+#include "jit_executor.hpp"
+#include "packed_executor.hpp"
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <unistd.h>
+#include <vector>
+
+/*
+ * Sweeps generated programs of growing size across all executors, to find out
+ * where each of them falls off the L1/L2/L3 and instruction cache cliffs.
+ **/
+
+using std::cout;
+using std::endl;
+using std::setw;
+using std::string;
+using std::vector;
+using namespace day25;
+typedef std::chrono::steady_clock Clock;
+
+struct Arguments {
+    vector<uint32_t> states = {2, 8, 32, 128, 1024, 10000, 100000};
+    vector<uint64_t> steps = {1000000, 1000000000};
+    vector<double> biases = {0.5, 0.9};
+    vector<string> executors;
+    double seconds = 1;
+    uint64_t seed = 1;
+};
+
+template <class T> vector<T> parse_list(const string &value) {
+    vector<T> result;
+    std::istringstream iss(value);
+    string item;
+    while (getline(iss, item, ',')) {
+        std::istringstream item_stream(item);
+        T v;
+        item_stream >> v;
+        result.push_back(v);
+    }
+    return result;
+}
+
+int usage(string cmd) {
+    auto last_slash = cmd.find_last_of('/');
+    if (last_slash != string::npos) {
+        cmd = cmd.substr(last_slash + 1);
+    }
+    cout << "Usage: " << cmd << " [options]" << endl
+         << endl
+         << "Options (lists are comma-separated):" << endl
+         << "  --states list      State counts to sweep" << endl
+         << "  --steps list       Checksum delays to sweep" << endl
+         << "  --bias list        Probabilities of moving right to sweep"
+         << endl
+         << "  --executors list   Executors to benchmark (default: all)"
+         << endl
+         << "  --seconds s        Time limit per measurement (default 1)"
+         << endl
+         << "  --seed n           Random seed for the generated programs"
+         << endl;
+    return 1;
+}
+
+void print_cache_sizes() {
+    struct {
+        const char *name;
+        int sysconf_name;
+    } caches[] = {
+        {"L1i", _SC_LEVEL1_ICACHE_SIZE},
+        {"L1d", _SC_LEVEL1_DCACHE_SIZE},
+        {"L2", _SC_LEVEL2_CACHE_SIZE},
+        {"L3", _SC_LEVEL3_CACHE_SIZE},
+    };
+    cout << "Cache sizes:";
+    for (auto cache : caches) {
+        auto size = sysconf(cache.sysconf_name);
+        cout << " " << cache.name << "=";
+        if (size > 0) {
+            cout << size / 1024 << "K";
+        } else {
+            cout << "?";
+        }
+    }
+    cout << endl << endl;
+}
+
+//! Estimate the bytes of code and tables an executor touches per step.
+uint64_t footprint(const string &executor_name, Executor *executor,
+                   const Program &program) {
+    if (executor_name == "bytecode") {
+        return program.states.size() * sizeof(uint64_t);
+    }
+    if (executor_name == "packed") {
+        return program.states.size() * 2048 * sizeof(PackedTransition);
+    }
+    if (auto jit_executor = dynamic_cast<JitExecutor *>(executor)) {
+        return jit_executor->jit().dump_memory().size();
+    }
+    return 0;
+}
+
+void measure(const Program &program, const string &executor_name,
+             const Arguments &args) {
+    auto setup_start = Clock::now();
+    std::shared_ptr<Executor> executor;
+    try {
+        executor = get_executor(executor_name, program);
+    } catch (const std::runtime_error &e) {
+        // E.g. programs that are too large for the packed executor's table.
+        cout << setw(12) << executor_name << "  skipped: " << e.what() << endl;
+        return;
+    }
+    auto setup_end = Clock::now();
+
+    auto deadline = setup_end + std::chrono::duration<double>(args.seconds);
+    uint64_t block = 100000;
+    while (executor->steps_executed() < program.checksum_delay &&
+           Clock::now() < deadline) {
+        executor->run(std::min<uint64_t>(
+            block, program.checksum_delay - executor->steps_executed()));
+    }
+    auto run_end = Clock::now();
+
+    std::chrono::duration<double, std::milli> setup_ms =
+        setup_end - setup_start;
+    std::chrono::duration<double, std::nano> run_ns = run_end - setup_end;
+    auto steps = executor->steps_executed();
+    auto bytes = footprint(executor_name, executor.get(), program);
+
+    cout << setw(12) << executor_name << setw(12) << setup_ms.count()
+         << setw(14) << steps << setw(12) << run_ns.count() / steps;
+    if (bytes) {
+        cout << setw(14) << bytes;
+    }
+    cout << endl;
+}
+
+int main(int argc, char **argv) {
+    Arguments args;
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        if (i + 1 >= argc) {
+            return usage(argv[0]);
+        }
+        string value = argv[++i];
+        if (arg == "--states") {
+            args.states = parse_list<uint32_t>(value);
+        } else if (arg == "--steps") {
+            args.steps = parse_list<uint64_t>(value);
+        } else if (arg == "--bias") {
+            args.biases = parse_list<double>(value);
+        } else if (arg == "--executors") {
+            args.executors = parse_list<string>(value);
+        } else if (arg == "--seconds") {
+            args.seconds = std::stod(value);
+        } else if (arg == "--seed") {
+            args.seed = std::stoull(value);
+        } else {
+            return usage(argv[0]);
+        }
+    }
+    if (args.executors.empty()) {
+        auto names = list_executors();
+        args.executors = vector<string>(names.begin(), names.end());
+    }
+
+    print_cache_sizes();
+    for (auto steps : args.steps) {
+        for (auto bias : args.biases) {
+            for (auto states : args.states) {
+                GeneratorOptions options;
+                options.states = states;
+                options.steps = steps;
+                options.right_bias = bias;
+                options.seed = args.seed;
+                auto program = generate_program(options);
+
+                cout << states << " states, " << steps << " steps, bias "
+                     << bias << ":" << endl
+                     << setw(12) << "executor" << setw(12) << "setup ms"
+                     << setw(14) << "steps" << setw(12) << "ns/step"
+                     << setw(14) << "footprint B" << endl;
+                for (auto name : args.executors) {
+                    measure(program, name, args);
+                }
+                cout << endl;
+            }
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,209 @@
+#include "day25.hpp"
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <linux/perf_event.h>
+#include <sstream>
+#include <stdexcept>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <vector>
+
+/*
+ * Runs a machine that sweeps across a wide tape, flipping every slot, with
+ * each page policy, and counts the dTLB misses it causes. With 4 KiB pages,
+ * every page the head enters needs a page walk once the tape outgrows the
+ * TLB's reach; with huge pages, one entry covers 2 MiB.
+ **/
+
+using std::cout;
+using std::endl;
+using std::setw;
+using std::string;
+using std::vector;
+using namespace day25;
+typedef std::chrono::steady_clock Clock;
+
+const char *SWEEP_PROGRAM = R"(Begin in state A.
+Perform a diagnostic checksum after 1 steps.
+
+In state A:
+  If the current value is 0:
+    - Write the value 1.
+    - Move one slot to the right.
+    - Continue with state A.
+  If the current value is 1:
+    - Write the value 0.
+    - Move one slot to the right.
+    - Continue with state A.
+)";
+
+struct Arguments {
+    uint64_t slots = 256 << 20;
+    vector<string> executors = {"bytecode", "jit", "packed"};
+    double seconds = 2;
+};
+
+vector<string> parse_list(const string &value) {
+    vector<string> result;
+    std::istringstream iss(value);
+    string item;
+    while (getline(iss, item, ',')) {
+        result.push_back(item);
+    }
+    return result;
+}
+
+int usage(string cmd) {
+    auto last_slash = cmd.find_last_of('/');
+    if (last_slash != string::npos) {
+        cmd = cmd.substr(last_slash + 1);
+    }
+    cout << "Usage: " << cmd << " [options]" << endl
+         << endl
+         << "Options:" << endl
+         << "  --slots n          Width of the tape (default 256Mi)" << endl
+         << "  --executors list   Comma-separated executors to benchmark"
+         << endl
+         << "  --seconds s        Time per measurement (default 2)" << endl;
+    return 1;
+}
+
+//! A user-space hardware cache event counter for the calling thread.
+class DtlbCounter {
+  public:
+    DtlbCounter(uint64_t op) {
+        perf_event_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = PERF_TYPE_HW_CACHE;
+        attr.config = PERF_COUNT_HW_CACHE_DTLB | (op << 8) |
+                      (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+        attr.disabled = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        m_fd = syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+    }
+    ~DtlbCounter() {
+        if (m_fd >= 0) {
+            close(m_fd);
+        }
+    }
+    bool available() const { return m_fd >= 0; }
+    void start() {
+        if (available()) {
+            ioctl(m_fd, PERF_EVENT_IOC_RESET, 0);
+            ioctl(m_fd, PERF_EVENT_IOC_ENABLE, 0);
+        }
+    }
+    void stop() {
+        if (available()) {
+            ioctl(m_fd, PERF_EVENT_IOC_DISABLE, 0);
+        }
+    }
+    uint64_t value() const {
+        uint64_t count = 0;
+        if (!available() || read(m_fd, &count, sizeof(count)) != sizeof(count)) {
+            return 0;
+        }
+        return count;
+    }
+
+  private:
+    int m_fd;
+};
+
+string reserved_huge_pages() {
+    std::ifstream ifs("/proc/sys/vm/nr_hugepages");
+    string count;
+    return (ifs >> count) ? count : "?";
+}
+
+void measure(const Program &program, const string &executor_name,
+             HugePages huge_pages, const Arguments &args) {
+    const char *names[] = {"none", "transparent", "explicit"};
+    cout << setw(12) << executor_name << setw(13)
+         << names[(int)huge_pages];
+
+    ExecutorOptions options;
+    options.pages.huge_pages = huge_pages;
+    std::shared_ptr<Executor> executor;
+    try {
+        executor = get_executor(executor_name, program, options);
+        // Start on a tape that already spans all slots, so the measurement
+        // does not include growing it.
+        executor->restore_machine_state(MachineState{
+            .tape = vector<uint8_t>(args.slots, 1),
+            .head = 0,
+            .state = program.initial_state,
+            .steps = 0,
+        });
+    } catch (const std::runtime_error &e) {
+        cout << "  skipped: " << e.what() << endl;
+        return;
+    }
+
+    DtlbCounter loads(PERF_COUNT_HW_CACHE_OP_READ);
+    DtlbCounter stores(PERF_COUNT_HW_CACHE_OP_WRITE);
+    auto deadline = Clock::now() + std::chrono::duration<double>(args.seconds);
+    auto start = Clock::now();
+    loads.start();
+    stores.start();
+    while (Clock::now() < deadline) {
+        executor->run(args.slots / 4);
+    }
+    loads.stop();
+    stores.stop();
+    std::chrono::duration<double, std::nano> run_ns = Clock::now() - start;
+    auto steps = executor->steps_executed();
+
+    cout << setw(14) << steps << setw(10) << run_ns.count() / steps;
+    for (auto counter : {&loads, &stores}) {
+        if (counter->available()) {
+            cout << setw(18) << counter->value() * 1e6 / steps;
+        } else {
+            cout << setw(18) << "unavailable";
+        }
+    }
+    cout << setw(14) << executor->memory_usage(false).tape_reserved << endl;
+}
+
+int main(int argc, char **argv) {
+    Arguments args;
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        if (i + 1 >= argc) {
+            return usage(argv[0]);
+        }
+        string value = argv[++i];
+        if (arg == "--slots") {
+            args.slots = std::stoull(value);
+        } else if (arg == "--executors") {
+            args.executors = parse_list(value);
+        } else if (arg == "--seconds") {
+            args.seconds = std::stod(value);
+        } else {
+            return usage(argv[0]);
+        }
+    }
+
+    auto program = load_string(SWEEP_PROGRAM);
+    // The tape wraps around at its maximum size, so the head sweeps forever.
+    program.checksum_delay = args.slots;
+
+    cout << "Sweeping " << args.slots << " slots; "
+         << "explicit huge pages reserved: " << reserved_huge_pages() << endl
+         << setw(12) << "executor" << setw(13) << "huge pages" << setw(14)
+         << "steps" << setw(10) << "ns/step" << setw(18) << "load miss/Mstep"
+         << setw(18) << "store miss/Mstep" << setw(14) << "tape B" << endl;
+    for (auto name : args.executors) {
+        for (auto huge_pages : {HugePages::NONE, HugePages::TRANSPARENT,
+                                HugePages::EXPLICIT}) {
+            measure(program, name, huge_pages, args);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,112 @@
+#include "d25.h"
+#include "day25.hpp"
+#include <algorithm>
+#include <cstring>
+#include <exception>
+#include <vector>
+
+using namespace day25;
+
+struct d25_program {
+    Program program;
+};
+
+struct d25_executor {
+    std::shared_ptr<Executor> executor;
+    std::string state;
+};
+
+namespace {
+void set_error(char *error, size_t error_size, const char *message) {
+    if (error && error_size) {
+        strncpy(error, message, error_size - 1);
+        error[error_size - 1] = 0;
+    }
+}
+
+const std::vector<std::string> &executor_types() {
+    static const std::vector<std::string> types = [] {
+        auto names = list_executors();
+        return std::vector<std::string>(names.begin(), names.end());
+    }();
+    return types;
+}
+} // namespace
+
+extern "C" {
+int d25_api_version(void) { return D25_API_VERSION; }
+
+d25_program *d25_program_parse(const char *source, size_t length, char *error,
+                               size_t error_size) {
+    try {
+        return new d25_program{load_string(std::string(source, length))};
+    } catch (const std::exception &e) {
+        set_error(error, error_size, e.what());
+        return nullptr;
+    }
+}
+
+uint64_t d25_program_checksum_delay(const d25_program *program) {
+    return program->program.checksum_delay;
+}
+
+void d25_program_destroy(d25_program *program) { delete program; }
+
+size_t d25_executor_type_count(void) { return executor_types().size(); }
+
+const char *d25_executor_type_name(size_t index) {
+    if (index >= executor_types().size()) {
+        return nullptr;
+    }
+    return executor_types()[index].c_str();
+}
+
+d25_executor *d25_executor_create(const d25_program *program, const char *type,
+                                  char *error, size_t error_size) {
+    try {
+        const auto &types = executor_types();
+        if (std::find(types.begin(), types.end(), type) == types.end()) {
+            set_error(error, error_size, "Unknown executor type.");
+            return nullptr;
+        }
+        return new d25_executor{get_executor(type, program->program), ""};
+    } catch (const std::exception &e) {
+        set_error(error, error_size, e.what());
+        return nullptr;
+    }
+}
+
+int d25_executor_run(d25_executor *executor, uint64_t steps, char *error,
+                     size_t error_size) {
+    try {
+        executor->executor->run(steps);
+        return 0;
+    } catch (const std::exception &e) {
+        set_error(error, error_size, e.what());
+        return -1;
+    }
+}
+
+uint64_t d25_executor_checksum(d25_executor *executor) {
+    return executor->executor->diagnostic_checksum();
+}
+
+uint64_t d25_executor_head(const d25_executor *executor) {
+    return executor->executor->head();
+}
+
+const char *d25_executor_state(d25_executor *executor) {
+    executor->state = executor->executor->state();
+    return executor->state.c_str();
+}
+
+uint64_t d25_executor_steps(const d25_executor *executor) {
+    return executor->executor->steps_executed();
+}
+
+void d25_executor_reset(d25_executor *executor) {
+    executor->executor->reset();
+}
+
+void d25_executor_destroy(d25_executor *executor) { delete executor; }
+}
@@ -0,0 +1,185 @@
+#include "c_generator.hpp"
+#include <algorithm>
+#include <map>
+
+using std::endl;
+using std::map;
+using std::ostream;
+using std::string;
+
+namespace day25 {
+namespace {
+string macro_prefix(const CGeneratorOptions &options) {
+    auto result = options.prefix;
+    std::transform(result.begin(), result.end(), result.begin(), ::toupper);
+    return result;
+}
+
+map<string, unsigned> state_indexes(const Program &program) {
+    map<string, unsigned> indexes;
+    for (auto &state : program.states) {
+        indexes[state.first] = indexes.size();
+    }
+    return indexes;
+}
+
+void generate_action(ostream &os, const StateAction &action,
+                     const map<string, unsigned> &indexes) {
+    os << "    *head = " << action.write_value << ";" << endl;
+    if (action.move_direction > 0) {
+        os << "    if (++head == end) head = tape;" << endl;
+    } else {
+        os << "    if (head == tape) head = end;" << endl
+           << "    head--;" << endl;
+    }
+    os << "    goto state_" << indexes.at(action.next_state) << ";" << endl;
+}
+
+void generate_harness(ostream &os, const CGeneratorOptions &options) {
+    auto name = options.prefix;
+    auto macro = macro_prefix(options);
+    os << "#include <stdio.h>" << endl
+       << "#include <stdlib.h>" << endl
+       << "#include <string.h>" << endl
+       << "#include <time.h>" << endl
+       << endl
+       << "#define ITERATIONS 25" << endl
+       << endl
+       << "int main() {" << endl
+       // calloc() of a large tape maps zero pages lazily, so memory use grows
+       // with the distance the head travels instead of the number of steps.
+       << "  unsigned char *tape = calloc(" << macro << "_TAPE_SIZE, 1);"
+       << endl
+       << "  unsigned state;" << endl
+       << "  unsigned long long head;" << endl
+       << "  //Benchmark:" << endl
+       << "  clock_t start_ts = clock();" << endl
+       << "  for (int i = 0; i < ITERATIONS; i++) {" << endl
+       << "    state = " << macro << "_INITIAL_STATE;" << endl
+       << "    head = 0;" << endl
+       << "    " << name << "_run(tape, " << macro
+       << "_CHECKSUM_DELAY, &state, &head);" << endl
+       << "  }" << endl
+       << "  double duration = clock() - start_ts;" << endl
+       << "  duration /= CLOCKS_PER_SEC;" << endl
+       << "  duration *= 1000;" << endl
+       << "  double steps = (double)ITERATIONS * " << macro
+       << "_CHECKSUM_DELAY;" << endl
+       << R"(  printf("Time per iteration: %lfms\n", duration / ITERATIONS);)"
+       << endl
+       << R"(  printf("Total executed steps: %.0lf\n", steps);)" << endl
+       << R"(  printf("%lf steps/ms\n%lf us/step\n", steps / duration, 1000 * duration / steps);)"
+       << endl
+       << "  //Actual execution:" << endl
+       << "  memset(tape, 0, " << macro << "_TAPE_SIZE);" << endl
+       << "  state = " << macro << "_INITIAL_STATE;" << endl
+       << "  head = 0;" << endl
+       << "  " << name << "_run(tape, " << macro
+       << "_CHECKSUM_DELAY, &state, &head);" << endl
+       << "  unsigned long long checksum = 0;" << endl
+       << "  for (unsigned long long i = 0; i < " << macro
+       << "_TAPE_SIZE; i++) {" << endl
+       << "    checksum += tape[i];" << endl
+       << "  }" << endl
+       << R"(  printf("Checksum: %llu\n", checksum);)" << endl
+       << "  free(tape);" << endl
+       << "  return 0;" << endl
+       << "}" << endl;
+}
+} // namespace
+
+void generate_c_header(ostream &os, const Program &program,
+                       const CGeneratorOptions &options) {
+    auto name = options.prefix;
+    auto macro = macro_prefix(options);
+    auto indexes = state_indexes(program);
+    os << "#ifndef " << macro << "_H" << endl
+       << "#define " << macro << "_H" << endl
+       << endl
+       << "#ifdef __cplusplus" << endl
+       << "extern \"C\" {" << endl
+       << "#endif" << endl
+       << endl
+       << "#define " << macro << "_TAPE_SIZE "
+       << std::max<uint64_t>(program.checksum_delay, 1) << "ULL" << endl
+       << "#define " << macro << "_CHECKSUM_DELAY " << program.checksum_delay
+       << "ULL" << endl
+       << "#define " << macro << "_STATE_COUNT " << program.states.size()
+       << endl
+       << "#define " << macro << "_INITIAL_STATE "
+       << indexes.at(program.initial_state) << endl
+       << endl
+       << "extern const char *const " << name << "_state_names["
+       << macro << "_STATE_COUNT];" << endl
+       << endl
+       << "/* Run `steps` steps, continuing in *state at slot *head of `tape`."
+       << endl
+       << " * `tape` holds " << macro
+       << "_TAPE_SIZE slots and wraps around at its ends. */" << endl
+       << "void " << name
+       << "_run(unsigned char *tape, unsigned long long steps, "
+          "unsigned *state, unsigned long long *head);"
+       << endl
+       << endl
+       << "#ifdef __cplusplus" << endl
+       << "}" << endl
+       << "#endif" << endl
+       << endl
+       << "#endif" << endl;
+}
+
+void generate_c_source(ostream &os, const Program &program,
+                       const string &header_name,
+                       const CGeneratorOptions &options) {
+    auto name = options.prefix;
+    auto macro = macro_prefix(options);
+    auto indexes = state_indexes(program);
+
+    os << "#include \"" << header_name << "\"" << endl << endl;
+
+    os << "const char *const " << name << "_state_names[" << macro
+       << "_STATE_COUNT] = {" << endl;
+    for (auto &state : program.states) {
+        os << "  \"" << state.first << "\"," << endl;
+    }
+    os << "};" << endl << endl;
+
+    os << "void " << name
+       << "_run(unsigned char *tape, unsigned long long steps, "
+          "unsigned *state, unsigned long long *head_index) {"
+       << endl
+       << "  unsigned char *const end = tape + " << macro << "_TAPE_SIZE;"
+       << endl
+       << "  unsigned char *head = tape + *head_index;" << endl
+       << "  unsigned current;" << endl
+       << "  switch (*state) {" << endl;
+    for (auto &state : program.states) {
+        os << "  case " << indexes.at(state.first) << ": goto state_"
+           << indexes.at(state.first) << ";" << endl;
+    }
+    os << "  default: return;" << endl << "  }" << endl;
+
+    for (auto &state : program.states) {
+        auto index = indexes.at(state.first);
+        os << "state_" << index << ": /* " << state.first << " */" << endl
+           << "  if (!steps--) {" << endl
+           << "    current = " << index << ";" << endl
+           << "    goto done;" << endl
+           << "  }" << endl
+           << "  if (*head == 0) {" << endl;
+        generate_action(os, state.second.actions.at(0), indexes);
+        os << "  } else {" << endl;
+        generate_action(os, state.second.actions.at(1), indexes);
+        os << "  }" << endl;
+    }
+    os << "done:" << endl
+       << "  *state = current;" << endl
+       << "  *head_index = head - tape;" << endl
+       << "}" << endl;
+
+    if (options.benchmark_harness) {
+        os << endl;
+        generate_harness(os, options);
+    }
+}
+} // namespace day25
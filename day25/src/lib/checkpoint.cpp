@@ -0,0 +1,151 @@
+#include "checkpoint.hpp"
+#include "executor.hpp"
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+using std::ifstream;
+using std::istream;
+using std::ofstream;
+using std::ostream;
+using std::runtime_error;
+using std::string;
+
+namespace day25 {
+namespace {
+// File layout (all integers little-endian as written by the host):
+// 8 bytes   magic "D25CKPT1"
+// u64       steps
+// u64       head
+// u32       length of state name, followed by the name itself
+// u64       tape size
+// u64       number of runs, followed by that many (u8 value, varint length)
+const char MAGIC[] = "D25CKPT1";
+
+template <class T> void write_raw(ostream &os, const T &v) {
+    os.write((const char *)&v, sizeof(T));
+}
+
+template <class T> T read_raw(istream &is) {
+    T v;
+    if (!is.read((char *)&v, sizeof(T))) {
+        throw runtime_error("Truncated checkpoint.");
+    }
+    return v;
+}
+
+void write_varint(ostream &os, uint64_t v) {
+    while (v >= 0x80) {
+        write_raw<uint8_t>(os, (v & 0x7f) | 0x80);
+        v >>= 7;
+    }
+    write_raw<uint8_t>(os, v);
+}
+
+uint64_t read_varint(istream &is) {
+    uint64_t result = 0;
+    for (unsigned shift = 0; shift < 64; shift += 7) {
+        auto byte = read_raw<uint8_t>(is);
+        result |= (uint64_t)(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) {
+            return result;
+        }
+    }
+    throw runtime_error("Invalid length in checkpoint.");
+}
+} // namespace
+
+void write_checkpoint(ostream &os, const MachineState &state) {
+    os.write(MAGIC, 8);
+    write_raw<uint64_t>(os, state.steps);
+    write_raw<uint64_t>(os, state.head);
+    write_raw<uint32_t>(os, state.state.size());
+    os.write(state.state.data(), state.state.size());
+    write_raw<uint64_t>(os, state.tape.size());
+
+    // Count runs first, so readers know how much to expect:
+    uint64_t runs = 0;
+    for (uint64_t i = 0; i < state.tape.size(); i++) {
+        if (i == 0 || state.tape[i] != state.tape[i - 1]) {
+            runs++;
+        }
+    }
+    write_raw<uint64_t>(os, runs);
+
+    uint64_t i = 0;
+    while (i < state.tape.size()) {
+        auto value = state.tape[i];
+        uint64_t length = 1;
+        while (i + length < state.tape.size() &&
+               state.tape[i + length] == value) {
+            length++;
+        }
+        write_raw<uint8_t>(os, value);
+        write_varint(os, length);
+        i += length;
+    }
+}
+
+MachineState read_checkpoint(istream &is) {
+    char magic[8];
+    if (!is.read(magic, 8) || memcmp(magic, MAGIC, 8) != 0) {
+        throw runtime_error("Not a checkpoint file.");
+    }
+    MachineState state;
+    state.steps = read_raw<uint64_t>(is);
+    state.head = read_raw<uint64_t>(is);
+    state.state.resize(read_raw<uint32_t>(is));
+    if (!is.read(&state.state[0], state.state.size())) {
+        throw runtime_error("Truncated checkpoint.");
+    }
+    auto tape_size = read_raw<uint64_t>(is);
+    auto runs = read_raw<uint64_t>(is);
+    state.tape.reserve(tape_size);
+    for (uint64_t i = 0; i < runs; i++) {
+        auto value = read_raw<uint8_t>(is);
+        auto length = read_varint(is);
+        if (state.tape.size() + length > tape_size) {
+            throw runtime_error("Checkpoint tape exceeds declared size.");
+        }
+        state.tape.insert(state.tape.end(), length, value);
+    }
+    if (state.tape.size() != tape_size || state.head >= tape_size) {
+        throw runtime_error("Inconsistent tape in checkpoint.");
+    }
+    return state;
+}
+
+void Executor::save_checkpoint(const string &filename) const {
+    save_checkpoint(filename, machine_state());
+}
+
+void Executor::save_checkpoint(const string &filename,
+                               const MachineState &state) {
+    // Write to a temporary file first, so a crash while writing never
+    // destroys the previous checkpoint.
+    auto tmp_name = filename + ".tmp";
+    {
+        ofstream ofs(tmp_name, std::ios::binary | std::ios::trunc);
+        if (ofs.fail()) {
+            throw runtime_error("Could not open file " + tmp_name);
+        }
+        write_checkpoint(ofs, state);
+        ofs.flush();
+        if (ofs.fail()) {
+            throw runtime_error("Could not write checkpoint " + tmp_name);
+        }
+    }
+    if (std::rename(tmp_name.c_str(), filename.c_str())) {
+        throw runtime_error("Could not replace checkpoint " + filename);
+    }
+}
+
+void Executor::load_checkpoint(const string &filename) {
+    ifstream ifs(filename, std::ios::binary);
+    if (ifs.fail()) {
+        throw runtime_error("Could not open file " + filename);
+    }
+    restore_machine_state(read_checkpoint(ifs));
+}
+} // namespace day25
@@ -2,9 +2,14 @@
 #include "ast_executor.hpp"
 #include "bytecode_executor.hpp"
 #include "jit_executor.hpp"
+#include "packed_executor.hpp"
+#include "profile.hpp"
+#include "tiered_executor.hpp"
 
-#include <map>
+#include <algorithm>
 #include <functional>
+#include <map>
+#include <stdexcept>
 using std::function;
 using std::list;
 using std::map;
@@ -13,29 +18,173 @@ using std::string;
 
 namespace day25 {
 namespace {
-typedef function<shared_ptr<Executor>(Program)> ExecutorFactory;
-
-static map<string, ExecutorFactory> factories = {
-    std::make_pair("ast",
-                   [](auto p) { return std::make_shared<AstExecutor>(p); }),
-    std::make_pair("bytecode", [](auto p) {
-        return std::make_shared<BytecodeExecutor>(p);
-    }),
-    std::make_pair("jit", [](auto p) {
-        return std::make_shared<JitExecutor>(p);
-    }),
+/** All executor types by name.
+ *
+ * A function-local static, so that \ref register_executor works from static
+ * initializers in other translation units.
+ */
+map<string, ProgramCompiler> &compilers() {
+    static map<string, ProgramCompiler> compilers = {
+        std::make_pair("ast",
+                       [](auto p, auto &) {
+                           return std::make_shared<AstProgram>(p);
+                       }),
+        std::make_pair("bytecode",
+                       [](auto p, auto &) {
+                           return std::make_shared<BytecodeProgram>(p);
+                       }),
+        std::make_pair("jit",
+                       [](auto p, auto &options) {
+                           return std::make_shared<JitProgram>(
+                               p, nullptr, options.pages, false,
+                               options.observed, options.stop);
+                       }),
+        std::make_pair("jit-pgo",
+                       [](auto p, auto &options) {
+                           auto profile = collect_profile(
+                               p, std::min(p.checksum_delay,
+                                           DEFAULT_PROFILE_STEPS));
+                           return std::make_shared<JitProgram>(
+                               p, &profile, options.pages, false,
+                               options.observed, options.stop);
+                       }),
+        std::make_pair("jit-trace",
+                       [](auto p, auto &options) {
+                           auto profile = collect_profile(
+                               p, std::min(p.checksum_delay,
+                                           DEFAULT_PROFILE_STEPS));
+                           return std::make_shared<JitProgram>(
+                               p, &profile, options.pages, true,
+                               options.observed, options.stop);
+                       }),
+        std::make_pair("packed",
+                       [](auto p, auto &) {
+                           return std::make_shared<PackedProgram>(p);
+                       }),
+        std::make_pair("tiered",
+                       [](auto p, auto &options) {
+                           return std::make_shared<TieredProgram>(
+                               p, options.pages);
+                       }),
+    };
+    return compilers;
+}
+
+/** A compiled program whose executors run on a tape with different policies
+ * than the default \ref Tape.
+ */
+template <class Compiled, template <class, class> class ExecutorT, class TapeT>
+class TapeVariantProgram : public Compiled {
+  public:
+    using Compiled::Compiled;
+    virtual shared_ptr<Executor>
+    instantiate(const ExecutorOptions &options) const {
+        auto compiled =
+            std::static_pointer_cast<const Compiled>(this->shared_from_this());
+        if (options.observer) {
+            return std::make_shared<ExecutorT<TapeT, ObserverRef>>(
+                compiled, options, ObserverRef{options.observer});
+        }
+        return std::make_shared<ExecutorT<TapeT, NullObserver>>(compiled,
+                                                                options);
+    }
 };
+
+template <class Cells, template <class> class Storage, class Boundary>
+void add_tape_variants(map<string, ProgramCompiler> &variants) {
+    typedef BasicTape<Cells, Storage, Boundary> TapeT;
+    auto suffix = string(":") + Cells::name + ":" + Storage<uint8_t>::name +
+                  ":" + Boundary::name;
+    variants["ast" + suffix] = [](auto p, auto &) {
+        return std::make_shared<
+            TapeVariantProgram<AstProgram, BasicAstExecutor, TapeT>>(p);
+    };
+    variants["bytecode" + suffix] = [](auto p, auto &) {
+        return std::make_shared<
+            TapeVariantProgram<BytecodeProgram, BasicBytecodeExecutor, TapeT>>(p);
+    };
+}
+
+template <class Cells, template <class> class Storage>
+void add_boundaries(map<string, ProgramCompiler> &variants) {
+    add_tape_variants<Cells, Storage, GrowableBoundary>(variants);
+    add_tape_variants<Cells, Storage, CircularBoundary>(variants);
+}
+
+template <class Cells> void add_storages(map<string, ProgramCompiler> &variants) {
+    add_boundaries<Cells, FlatStorage>(variants);
+    add_boundaries<Cells, ChunkedStorage>(variants);
+    add_boundaries<Cells, MmapStorage>(variants);
+}
+
+//! `ast` and `bytecode` for every combination of tape policies.
+static map<string, ProgramCompiler> make_tape_variants() {
+    map<string, ProgramCompiler> variants;
+    add_storages<BitCells>(variants);
+    add_storages<ByteCells>(variants);
+    add_storages<U16Cells>(variants);
+    return variants;
+}
+
+static map<string, ProgramCompiler> tape_variants = make_tape_variants();
 } // namespace
 
-shared_ptr<Executor> get_executor(const string &type, Program p) {
-    return factories.at(type)(p);
+CompiledProgram::CompiledProgram(Program program) : m_program(program) {
+    m_program.link();
+}
+
+shared_ptr<const CompiledProgram> compile_program(const string &type,
+                                                  Program p,
+                                                  const CompileOptions &options) {
+    auto it = compilers().find(type);
+    if (it == compilers().end()) {
+        it = tape_variants.find(type);
+        if (it == tape_variants.end()) {
+            throw std::out_of_range("Unknown executor type: " + type);
+        }
+    }
+    return it->second(p, options);
+}
+
+shared_ptr<Executor> get_executor(const string &type, Program p,
+                                  const ExecutorOptions &options) {
+    return compile_program(type, p,
+                           CompileOptions{.pages = options.pages,
+                                          .observed = options.observer != nullptr,
+                                          .stop = options.stop})
+        ->instantiate(options);
 }
 
-list<string> list_executors() {
+const char *stop_reason_name(StopReason reason) {
+    switch (reason) {
+    case StopReason::NONE:
+        return "none";
+    case StopReason::CHECKSUM:
+        return "checksum";
+    case StopReason::HEAD:
+        return "head";
+    case StopReason::STATE:
+        return "state";
+    case StopReason::STEP_MULTIPLE:
+        return "step multiple";
+    }
+    return "unknown";
+}
+
+void register_executor(const string &type, ProgramCompiler compiler) {
+    compilers()[type] = compiler;
+}
+
+list<string> list_executors(bool include_variants) {
     list<string> names;
-    for (auto it : factories) {
+    for (auto it : compilers()) {
         names.push_back(it.first);
     }
+    if (include_variants) {
+        for (auto it : tape_variants) {
+            names.push_back(it.first);
+        }
+    }
     return names;
 }
 } // namespace day25
\ No newline at end of file
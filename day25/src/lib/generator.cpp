@@ -0,0 +1,80 @@
+#include "generator.hpp"
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+using std::endl;
+using std::ostream;
+using std::string;
+using std::to_string;
+using std::vector;
+
+namespace day25 {
+namespace {
+string state_name(uint32_t index, uint32_t count) {
+    // Keep the familiar single-letter names for small machines.
+    if (count <= 26) {
+        return string(1, 'A' + index);
+    }
+    return "S" + to_string(index);
+}
+} // namespace
+
+Program generate_program(const GeneratorOptions &options) {
+    if (options.states == 0) {
+        throw std::runtime_error("Programs need at least one state.");
+    }
+    if (options.right_bias < 0 || options.right_bias > 1) {
+        throw std::runtime_error("Movement bias must be between 0 and 1.");
+    }
+
+    std::mt19937_64 random(options.seed);
+    std::uniform_int_distribution<uint32_t> any_state(0, options.states - 1);
+    std::uniform_int_distribution<unsigned> any_value(0, 1);
+    std::bernoulli_distribution moves_right(options.right_bias);
+
+    vector<string> names;
+    for (uint32_t i = 0; i < options.states; i++) {
+        names.push_back(state_name(i, options.states));
+    }
+
+    Program program;
+    program.initial_state = names[0];
+    program.checksum_delay = options.steps;
+    for (uint32_t i = 0; i < options.states; i++) {
+        State state;
+        state.name = names[i];
+        for (unsigned slot = 0; slot <= 1; slot++) {
+            StateAction action;
+            action.slot_condition = slot;
+            action.write_value = any_value(random);
+            action.move_direction = moves_right(random) ? 1 : -1;
+            action.next_state = names[any_state(random)];
+            state.actions[slot] = action;
+        }
+        program.states[state.name] = state;
+    }
+    program.link();
+    return program;
+}
+
+void write_program(ostream &os, const Program &program) {
+    os << "Begin in state " << program.initial_state << "." << endl
+       << "Perform a diagnostic checksum after " << program.checksum_delay
+       << " steps." << endl;
+
+    for (auto state : program.states) {
+        os << endl << "In state " << state.first << ":" << endl;
+        for (auto action : state.second.actions) {
+            os << "  If the current value is " << action.first << ":" << endl
+               << "    - Write the value " << action.second.write_value << "."
+               << endl
+               << "    - Move one slot to the "
+               << (action.second.move_direction > 0 ? "right" : "left") << "."
+               << endl
+               << "    - Continue with state " << action.second.next_state
+               << "." << endl;
+        }
+    }
+}
+} // namespace day25
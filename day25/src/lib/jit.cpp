@@ -40,21 +40,25 @@ uint8_t register_pair(Register reg1, Register reg2) {
 }
 } // namespace
 
-Jit::Jit() : m_code_size(16384), m_offset(0), m_code_finalized(false) {
+Jit::Jit(uint32_t code_size, const PagePolicy &pages)
+    : m_code_size(code_size), m_offset(0), m_code_finalized(false) {
     if (sizeof(void *) != 8) {
         throw runtime_error("JIT is only available on 64-bit systems.");
     }
-    int prot = PROT_READ | PROT_WRITE;
-    int flags = MAP_ANONYMOUS | MAP_PRIVATE;
-    m_code = (uint8_t *)mmap(nullptr, m_code_size, prot, flags, -1, 0);
-    if (!m_code) {
+    try {
+        auto mapping = map_pages(m_code_size, pages, PROT_READ | PROT_WRITE);
+        m_code = (uint8_t *)mapping.address;
+        m_mapped_size = mapping.size;
+    } catch (runtime_error &) {
         throw runtime_error("Could not create code buffer for JIT.");
     }
 }
 
 Jit::~Jit() {
+    // Unregister before the code goes away.
+    m_debug_entry.reset();
     if (m_code) {
-        munmap(m_code, m_code_size);
+        munmap(m_code, m_mapped_size);
     }
     for (auto it: m_buffers) {
         if (it.second.address) {
@@ -68,7 +72,14 @@ void Jit::finalize_code() {
         return;
     }
 
-    for (auto ref : m_symbol_refs) {
+    // Only references emitted, or to symbols redefined, since the last call.
+    for (auto offset : m_unresolved_refs) {
+        auto it = m_symbol_refs.find(offset);
+        if (it == m_symbol_refs.end()) {
+            // Overwritten by patch_jmp.
+            continue;
+        }
+        auto &ref = it->second;
         auto symbol = this->symbol(ref.symbol);
         if (symbol.address == nullptr) {
             throw runtime_error("Reference to undefined symbol " + ref.symbol);
@@ -106,11 +117,31 @@ void Jit::finalize_code() {
                 "replacement size that is not 1, 2 or 4 bytes.");
         }
     }
+    m_unresolved_refs.clear();
 
-    if (mprotect(m_code, m_code_size, PROT_READ | PROT_EXEC)) {
+    if (mprotect(m_code, m_mapped_size, PROT_READ | PROT_EXEC)) {
         throw runtime_error("Could not mark code as executable.");
     }
     m_code_finalized = true;
+
+    if (jit_debug_info() != JIT_DEBUG_NONE) {
+        if (!m_debug_entry) {
+            m_debug_entry.reset(new JitDebugEntry());
+        }
+        m_debug_entry->update(m_code, m_offset, code_symbols());
+    }
+}
+
+void Jit::reopen_code() {
+    if (!m_code_finalized) {
+        return;
+    }
+    // The buffer is never writable and executable at the same time, so
+    // nothing may run the code until the next finalize_code.
+    if (mprotect(m_code, m_mapped_size, PROT_READ | PROT_WRITE)) {
+        throw runtime_error("Could not mark code as writable.");
+    }
+    m_code_finalized = false;
 }
 
 void Jit::emit_symbol(const std::string &name) {
@@ -124,22 +155,82 @@ void Jit::emit_symbol(const std::string &name, void *location) {
     m_symbols[name] = location;
 }
 
+void Jit::undefine_symbol(const std::string &name) {
+    if (!m_symbols.erase(name)) {
+        return;
+    }
+    // Existing references are resolved again once the symbol is redefined.
+    auto refs = m_refs_to.find(name);
+    if (refs != m_refs_to.end()) {
+        m_unresolved_refs.insert(m_unresolved_refs.end(), refs->second.begin(),
+                                 refs->second.end());
+    }
+}
+
+void Jit::patch_jmp(const Symbol &location, const Symbol &target) {
+    if (m_code_finalized) {
+        throw runtime_error("Code is finalized, call reopen_code() first.");
+    }
+    if (location.offset < 0 || location.offset + 5 > (int64_t)m_offset) {
+        throw runtime_error("Cannot patch code outside of the jit code area.");
+    }
+    uint32_t offset = location.offset;
+    // References overlapping the overwritten bytes are gone. None is longer
+    // than 8 bytes, so none starts further in front.
+    auto it = m_symbol_refs.lower_bound(offset < 7 ? 0 : offset - 7);
+    while (it != m_symbol_refs.end() && it->first < offset + 5) {
+        if (it->first + it->second.replacement_length > offset) {
+            it = erase_symbol_ref(it);
+        } else {
+            ++it;
+        }
+    }
+    m_code[offset] = 0xe9;
+    add_symbol_ref(SymbolRef{.absolute = false,
+                             .offset = offset + 1,
+                             .symbol = target.name,
+                             .replacement_length = sizeof(uint32_t)});
+}
+
 void Jit::emit_symbol_ref(const std::string &name) {
-    m_symbol_refs.push_back(SymbolRef{.absolute = true,
-                                      .offset = m_offset,
-                                      .symbol = name,
-                                      .replacement_length = sizeof(void *)});
+    add_symbol_ref(SymbolRef{.absolute = true,
+                             .offset = m_offset,
+                             .symbol = name,
+                             .replacement_length = sizeof(void *)});
 }
 
 void Jit::emit_symbol_relative_ref(const std::string &name,
                                    uint8_t ref_length) {
-    m_symbol_refs.push_back(SymbolRef{.absolute = false,
-                                      .offset = m_offset,
-                                      .symbol = name,
-                                      .replacement_length = ref_length});
+    add_symbol_ref(SymbolRef{.absolute = false,
+                             .offset = m_offset,
+                             .symbol = name,
+                             .replacement_length = ref_length});
+}
+
+void Jit::add_symbol_ref(const SymbolRef &ref) {
+    auto existing = m_symbol_refs.find(ref.offset);
+    if (existing != m_symbol_refs.end()) {
+        erase_symbol_ref(existing);
+    }
+    m_symbol_refs.emplace(ref.offset, ref);
+    m_refs_to[ref.symbol].insert(ref.offset);
+    m_unresolved_refs.push_back(ref.offset);
+}
+
+std::map<uint32_t, Jit::SymbolRef>::iterator
+Jit::erase_symbol_ref(std::map<uint32_t, SymbolRef>::iterator ref) {
+    auto refs_to = m_refs_to.find(ref->second.symbol);
+    refs_to->second.erase(ref->first);
+    if (refs_to->second.empty()) {
+        m_refs_to.erase(refs_to);
+    }
+    return m_symbol_refs.erase(ref);
 }
 
 void Jit::emit(uint32_t length, const void *bytes) {
+    if (m_code_finalized) {
+        throw runtime_error("Code is finalized, call reopen_code() first.");
+    }
     if (length + m_offset >= m_code_size) {
         throw runtime_error("Generated code too large.");
     }
@@ -147,6 +238,12 @@ void Jit::emit(uint32_t length, const void *bytes) {
     m_offset += length;
 }
 
+void Jit::emit_align(uint32_t alignment) {
+    while ((uintptr_t)(m_code + m_offset) % alignment) {
+        emit((uint8_t)0xcc);
+    }
+}
+
 void Jit::emit_ret() { emit((uint8_t)0xc3); }
 
 void Jit::emit_mov(Register reg, uint64_t val) {
@@ -553,6 +650,14 @@ void Jit::add_buffer(const std::string &name, uint64_t size) {
     };
 }
 
+uint64_t Jit::data_size() const {
+    uint64_t size = 0;
+    for (auto &it : m_buffers) {
+        size += it.second.size;
+    }
+    return size;
+}
+
 vector<uint8_t> Jit::dump_memory() const {
     vector<uint8_t> result;
     result.resize(m_offset);
@@ -580,4 +685,31 @@ Symbol Jit::symbol(const std::string &name) const {
         return Symbol(name);
     }
 
-}
\ No newline at end of file
+}
+
+std::vector<JitCodeSymbol> Jit::code_symbols() const {
+    // Symbols in m_symbols are ordered by name, so the first one seen for an
+    // address is the first by name.
+    std::map<uint8_t *, std::string> by_address;
+    for (auto &it : m_symbols) {
+        auto loc = (uint8_t *)it.second;
+        if (loc < m_code || loc >= m_code + m_offset) {
+            continue;
+        }
+        auto existing = by_address.find(loc);
+        if (existing == by_address.end()) {
+            by_address[loc] = it.first;
+        } else if (existing->second[0] == '_' && it.first[0] != '_') {
+            existing->second = it.first;
+        }
+    }
+    std::vector<JitCodeSymbol> result;
+    for (auto it = by_address.begin(); it != by_address.end(); it++) {
+        auto next = std::next(it);
+        auto end = next == by_address.end() ? m_code + m_offset : next->first;
+        result.push_back(JitCodeSymbol{.name = it->second,
+                                       .address = (uint64_t)it->first,
+                                       .size = (uint64_t)(end - it->first)});
+    }
+    return result;
+}
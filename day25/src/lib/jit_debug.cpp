@@ -0,0 +1,205 @@
+#include "jit_debug.hpp"
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <elf.h>
+#include <mutex>
+#include <unistd.h>
+
+// The interface GDB sets a breakpoint on to learn about generated code, see
+// "JIT Compilation Interface" in the GDB manual. Names and layout are fixed.
+extern "C" {
+enum jit_actions_t : uint32_t {
+    JIT_NOACTION = 0,
+    JIT_REGISTER_FN,
+    JIT_UNREGISTER_FN,
+};
+
+struct jit_code_entry {
+    jit_code_entry *next_entry;
+    jit_code_entry *prev_entry;
+    const char *symfile_addr;
+    uint64_t symfile_size;
+};
+
+struct jit_descriptor {
+    uint32_t version;
+    uint32_t action_flag;
+    jit_code_entry *relevant_entry;
+    jit_code_entry *first_entry;
+};
+
+__attribute__((visibility("default"), noinline)) void
+__jit_debug_register_code() {
+    // Keeps the call from being optimized away.
+    asm volatile("" ::: "memory");
+}
+
+__attribute__((visibility("default")))
+jit_descriptor __jit_debug_descriptor = {1, JIT_NOACTION, nullptr, nullptr};
+}
+
+namespace day25 {
+namespace {
+std::atomic<unsigned> debug_flags(JIT_DEBUG_NONE);
+//! Serializes changes to the GDB descriptor and writes to the perf map.
+std::mutex debug_mutex;
+FILE *perf_map = nullptr;
+
+/** Build an ELF object file that only holds a symbol table, describing the
+ * `size` bytes of code at `code`. GDB reads the section address from the
+ * `.text` header, which takes no space in the file.
+ */
+std::vector<char> symbol_file(const void *code, uint64_t size,
+                              const std::vector<JitCodeSymbol> &symbols) {
+    enum { NULL_SECTION, TEXT, SYMTAB, STRTAB, SHSTRTAB, SECTION_COUNT };
+    const char section_names[] = "\0.text\0.symtab\0.strtab\0.shstrtab";
+    const uint32_t name_offsets[] = {0, 1, 7, 15, 23};
+
+    std::vector<Elf64_Sym> elf_symbols(1);
+    std::string names(1, '\0');
+    for (auto &symbol : symbols) {
+        Elf64_Sym elf_symbol;
+        memset(&elf_symbol, 0, sizeof(elf_symbol));
+        elf_symbol.st_name = names.size();
+        elf_symbol.st_info = ELF64_ST_INFO(STB_GLOBAL, STT_FUNC);
+        elf_symbol.st_shndx = TEXT;
+        // Relative to the section in relocatable files.
+        elf_symbol.st_value = symbol.address - (uint64_t)code;
+        elf_symbol.st_size = symbol.size;
+        elf_symbols.push_back(elf_symbol);
+        names += symbol.name;
+        names += '\0';
+    }
+
+    auto symtab_offset = sizeof(Elf64_Ehdr) + SECTION_COUNT * sizeof(Elf64_Shdr);
+    auto symtab_size = elf_symbols.size() * sizeof(Elf64_Sym);
+    auto strtab_offset = symtab_offset + symtab_size;
+    auto shstrtab_offset = strtab_offset + names.size();
+    std::vector<char> file(shstrtab_offset + sizeof(section_names));
+
+    Elf64_Ehdr header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.e_ident, ELFMAG, SELFMAG);
+    header.e_ident[EI_CLASS] = ELFCLASS64;
+    header.e_ident[EI_DATA] = ELFDATA2LSB;
+    header.e_ident[EI_VERSION] = EV_CURRENT;
+    header.e_ident[EI_OSABI] = ELFOSABI_SYSV;
+    header.e_type = ET_REL;
+    header.e_machine = EM_X86_64;
+    header.e_version = EV_CURRENT;
+    header.e_shoff = sizeof(Elf64_Ehdr);
+    header.e_ehsize = sizeof(Elf64_Ehdr);
+    header.e_shentsize = sizeof(Elf64_Shdr);
+    header.e_shnum = SECTION_COUNT;
+    header.e_shstrndx = SHSTRTAB;
+    memcpy(file.data(), &header, sizeof(header));
+
+    Elf64_Shdr sections[SECTION_COUNT];
+    memset(sections, 0, sizeof(sections));
+    sections[TEXT].sh_type = SHT_NOBITS;
+    sections[TEXT].sh_flags = SHF_ALLOC | SHF_EXECINSTR;
+    sections[TEXT].sh_addr = (uint64_t)code;
+    sections[TEXT].sh_offset = symtab_offset;
+    sections[TEXT].sh_size = size;
+    sections[TEXT].sh_addralign = 16;
+    sections[SYMTAB].sh_type = SHT_SYMTAB;
+    sections[SYMTAB].sh_offset = symtab_offset;
+    sections[SYMTAB].sh_size = symtab_size;
+    sections[SYMTAB].sh_link = STRTAB;
+    // Index of the first global symbol; only the null symbol is local.
+    sections[SYMTAB].sh_info = 1;
+    sections[SYMTAB].sh_addralign = 8;
+    sections[SYMTAB].sh_entsize = sizeof(Elf64_Sym);
+    sections[STRTAB].sh_type = SHT_STRTAB;
+    sections[STRTAB].sh_offset = strtab_offset;
+    sections[STRTAB].sh_size = names.size();
+    sections[STRTAB].sh_addralign = 1;
+    sections[SHSTRTAB].sh_type = SHT_STRTAB;
+    sections[SHSTRTAB].sh_offset = shstrtab_offset;
+    sections[SHSTRTAB].sh_size = sizeof(section_names);
+    sections[SHSTRTAB].sh_addralign = 1;
+    for (int i = 0; i < SECTION_COUNT; i++) {
+        sections[i].sh_name = name_offsets[i];
+    }
+    memcpy(file.data() + sizeof(Elf64_Ehdr), sections, sizeof(sections));
+
+    memcpy(file.data() + symtab_offset, elf_symbols.data(), symtab_size);
+    memcpy(file.data() + strtab_offset, names.data(), names.size());
+    memcpy(file.data() + shstrtab_offset, section_names, sizeof(section_names));
+    return file;
+}
+} // namespace
+
+struct JitDebugEntry::GdbEntry {
+    jit_code_entry entry;
+    std::vector<char> symbol_file;
+
+    GdbEntry(std::vector<char> file) : symbol_file(std::move(file)) {
+        entry.prev_entry = nullptr;
+        entry.symfile_addr = symbol_file.data();
+        entry.symfile_size = symbol_file.size();
+        std::lock_guard<std::mutex> lock(debug_mutex);
+        entry.next_entry = __jit_debug_descriptor.first_entry;
+        if (entry.next_entry) {
+            entry.next_entry->prev_entry = &entry;
+        }
+        __jit_debug_descriptor.first_entry = &entry;
+        __jit_debug_descriptor.relevant_entry = &entry;
+        __jit_debug_descriptor.action_flag = JIT_REGISTER_FN;
+        __jit_debug_register_code();
+    }
+
+    ~GdbEntry() {
+        std::lock_guard<std::mutex> lock(debug_mutex);
+        if (entry.prev_entry) {
+            entry.prev_entry->next_entry = entry.next_entry;
+        } else {
+            __jit_debug_descriptor.first_entry = entry.next_entry;
+        }
+        if (entry.next_entry) {
+            entry.next_entry->prev_entry = entry.prev_entry;
+        }
+        __jit_debug_descriptor.relevant_entry = &entry;
+        __jit_debug_descriptor.action_flag = JIT_UNREGISTER_FN;
+        __jit_debug_register_code();
+    }
+};
+
+void set_jit_debug_info(unsigned flags) { debug_flags = flags; }
+
+unsigned jit_debug_info() { return debug_flags; }
+
+JitDebugEntry::JitDebugEntry() {}
+
+JitDebugEntry::~JitDebugEntry() {}
+
+void JitDebugEntry::update(const void *code, uint64_t size,
+                           const std::vector<JitCodeSymbol> &symbols) {
+    auto flags = jit_debug_info();
+    if (flags & JIT_DEBUG_GDB) {
+        // GDB has no way to change a symbol file, only to replace it.
+        m_gdb.reset();
+        m_gdb.reset(new GdbEntry(symbol_file(code, size, symbols)));
+    }
+    if (flags & JIT_DEBUG_PERF_MAP) {
+        std::lock_guard<std::mutex> lock(debug_mutex);
+        if (!perf_map) {
+            auto path = "/tmp/perf-" + std::to_string(getpid()) + ".map";
+            perf_map = fopen(path.c_str(), "a");
+            if (!perf_map) {
+                return;
+            }
+        }
+        for (auto &symbol : symbols) {
+            if (m_perf_symbols.emplace(symbol.address, symbol.size, symbol.name)
+                    .second) {
+                fprintf(perf_map, "%llx %llx %s\n",
+                        (unsigned long long)symbol.address,
+                        (unsigned long long)symbol.size, symbol.name.c_str());
+            }
+        }
+        fflush(perf_map);
+    }
+}
+} // namespace day25
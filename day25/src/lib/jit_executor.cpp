@@ -1,156 +1,774 @@
 #include "jit_executor.hpp"
+#include <algorithm>
+#include <cstddef>
 #include <cstdint>
 #include <cstring>
-#include <iostream>
-
-using std::cout;
-using std::endl;
+#include <set>
+#include <stdexcept>
 
 namespace day25 {
     namespace {
-        void compile_state_action(Jit *jit, const State &state, const StateAction &action, const std::string &end_label) {
+        //! Upper bound for the code of one state, including its exit and alignment.
+        const uint64_t STATE_CODE_SIZE = 320;
+        //! Upper bound for the code of one trace of PROFILE_PATH_LENGTH steps, including its exits.
+        const uint64_t TRACE_CODE_SIZE = 800;
+        //! Share of the paths recorded from a state the most frequent one needs to become a trace.
+        const double MIN_TRACE_SHARE = 0.25;
+        //! Upper bound for the observer calls of one state.
+        const uint64_t OBSERVER_CODE_SIZE = 128;
+        //! Upper bound for the stop condition checks and exits of one state.
+        const uint64_t STOP_CODE_SIZE = 160;
+
+        /** Whether the generated code checks any of `stop`. Step multiples are left to
+         * \ref JitExecutor::run, which never runs past the next one.
+         */
+        bool compiles_stop(const StopConditions &stop) {
+            return stop.has_state() || stop.has_head_bounds() || stop.has_checksum_limit();
+        }
+
+        uint64_t state_code_size(bool observed, const StopConditions &stop) {
+            return STATE_CODE_SIZE + (observed ? OBSERVER_CODE_SIZE : 0) +
+                   (compiles_stop(stop) ? STOP_CODE_SIZE : 0);
+        }
+
+        /** Report the step about to run in `state` on tape value `slot` to the
+         * context's observer. Called from the generated code.
+         */
+        void observe_step(JitContext *context, uint64_t head, const State *state, uint64_t slot) {
+            if (!context->observer) {
+                return;
+            }
+            auto &action = state->actions.at(slot);
+            context->observer->write(head, slot, action.write_value);
+            context->observer->move(head, action.move_direction);
+            context->observer->transition(state->name, action.next_state);
+        }
+
+        //Registers used by the generated code:
+        //  RDI context
+        //  R09 &tape_offset
+        //  R10 tape_offset
+        //  R11 tape
+        //  R12 &state_name
+        //  R13 remaining steps
+        //  R14 &state_func
+        //  R15 tape_size
+        //  RBX ones, with a checksum limit
+
+        std::string state_label(const std::string &state, const std::string &part) {
+            return "_state_" + state + "_" + part;
+        }
+
+        //! One step of a \ref Trace.
+        struct TraceStep {
+            const State *state;
+            //! Head position before the step, relative to the head at the start of the trace.
+            int32_t offset;
+            //! The tape value the step reads.
+            unsigned slot;
+            //! Whether the slot has to be checked, i.e. was not written earlier in the trace.
+            bool guard;
+            //! Whether the step changes the slot.
+            bool store;
+        };
+
+        /** A path through the program that is compiled into straight-line code.
+         *
+         * The head only moves once, by `displacement`, at the end; each step accesses the tape at
+         * a constant offset from the head, within `[min_offset, max_offset]`. If a guard fails,
+         * the trace exits to the code of the state whose step read the unexpected value.
+         */
+        struct Trace {
+            std::vector<TraceStep> steps;
+            int32_t min_offset;
+            int32_t max_offset;
+            int32_t displacement;
+            //! The state to continue with after the last step.
+            std::string exit_state;
+        };
+
+        /** Follow the most frequent path recorded from `state`, if it is frequent enough.
+         *
+         * Steps reading a slot that an earlier step wrote need no guard: the value is known.
+         */
+        bool plan_trace(const Program &program, const Profile &profile, const State &state,
+                        Trace &trace) {
+            auto likely = profile.likely_path(state.name);
+            if (likely.second < MIN_TRACE_SHARE) {
+                return false;
+            }
+            std::map<int32_t, unsigned> written;
+            trace = Trace{{}, 0, 0, 0, ""};
+            const State *current = &state;
+            for (unsigned i = 0; i < PROFILE_PATH_LENGTH; i++) {
+                unsigned slot = (likely.first >> i) & 1;
+                auto known = written.find(trace.displacement);
+                if (known != written.end() && known->second != slot) {
+                    // Not a path the machine can take.
+                    break;
+                }
+                auto &action = current->actions.at(slot);
+                trace.steps.push_back(TraceStep{current, trace.displacement, slot,
+                                                known == written.end(), action.write_value != slot});
+                written[trace.displacement] = action.write_value;
+                trace.displacement += action.move_direction;
+                trace.min_offset = std::min(trace.min_offset, trace.displacement);
+                trace.max_offset = std::max(trace.max_offset, trace.displacement);
+                current = &program.states.at(action.next_state);
+            }
+            trace.exit_state = current->name;
+            return trace.steps.size() > 1;
+        }
+
+        std::map<std::string, Trace> plan_traces(const Program &program, const Profile &profile) {
+            std::map<std::string, Trace> traces;
+            for (auto &it : profile.paths) {
+                Trace trace;
+                if (plan_trace(program, profile, program.states.at(it.first), trace)) {
+                    traces[it.first] = trace;
+                }
+            }
+            return traces;
+        }
+
+        //! Where a state ends up in the generated code.
+        struct Placement {
+            const State *state;
+            //! The tape value whose action directly follows the state's entry.
+            unsigned hot_slot;
+            //! Emit the other action right behind the hot one instead of in the cold section.
+            bool cold_inline;
+            //! Start the state on a new cache line.
+            bool align;
+            //! Trace to try before the state's own code, if any.
+            const Trace *trace;
+            //! Call \ref observe_step before each step.
+            bool observed;
+            //! Conditions to check after each step, if any.
+            const StopConditions *stop;
+        };
+
+        //! Write `cmp reg, [R9 + ...]` for the JitContext field at `offset`.
+        void compile_context_cmp(Jit *jit, Register reg, size_t offset) {
+            auto displacement = (int8_t)(offset - offsetof(JitContext, tape_offset));
+            jit->emit((uint8_t)(0x49 | (reg >= Register::R8 ? 0x04 : 0)));
+            jit->emit((uint8_t)0x3B);
+            jit->emit((uint8_t)(0x41 | ((uint8_t)reg & 0x7) << 3));
+            jit->emit(displacement);
+        }
+
+        //! Point `reg` at the JitContext field at `offset`.
+        void compile_context_field(Jit *jit, Register reg, size_t offset) {
+            jit->emit_mov(reg, Register::R9);
+            jit->emit_add(reg, (int8_t)(offset - offsetof(JitContext, tape_offset)));
+        }
+
+        //! Store `reason` in the context, then continue in `state` next time.
+        void compile_stop(Jit *jit, StopReason reason, const std::string &state) {
+            compile_context_field(jit, Register::RAX, offsetof(JitContext, stop_reason));
+            jit->emit_mov(Register::RCX, (uint64_t)reason);
+            jit->emit_mov(Indirect(Register::RAX), Register::RCX);
+            jit->emit_jmp(jit->symbol(state_label(state, "leave")));
+        }
+
+        /** Emit the exits for the actions of `state` that raise the checksum: they finish the
+         * step, then stop (`_state_<name>_stop<slot>`).
+         */
+        void compile_checksum_exits(Jit *jit, const State &state) {
+            for (unsigned slot = 0; slot <= 1; slot++) {
+                auto &action = state.actions.at(slot);
+                if (action.write_value <= slot) {
+                    continue;
+                }
+                jit->emit_symbol(state_label(state.name, "stop" + std::to_string(slot)));
+                if (action.move_direction > 0) {
+                    jit->emit_inc(Register::R10);
+                } else {
+                    jit->emit_dec(Register::R10);
+                }
+                compile_stop(jit, StopReason::CHECKSUM, action.next_state);
+            }
+        }
+
+        //! Call \ref observe_step, keeping all registers the state code uses.
+        void compile_observer_call(Jit *jit, const State &state, unsigned slot) {
+            //R12 to R15 are callee-saved. The 4th push keeps the stack 16-byte aligned.
+            for (auto reg : {Register::R9, Register::R10, Register::R11, Register::R11}) {
+                jit->emit_push(reg);
+            }
+            jit->emit_mov(Register::RDI, Register::R9);
+            jit->emit_sub(Register::RDI, (int8_t)offsetof(JitContext, tape_offset));
+            jit->emit_mov(Register::RSI, Register::R10);
+            jit->emit_mov(Register::RDX, (uint64_t)&state);
+            jit->emit_mov(Register::RCX, (uint64_t)slot);
+            jit->emit_mov(Register::RAX, (uint64_t)&observe_step);
+            jit->emit_call(Register::RAX);
+            for (auto reg : {Register::R11, Register::R11, Register::R10, Register::R9}) {
+                jit->emit_pop(reg);
+            }
+        }
+
+        void compile_state_action(Jit *jit, const Placement &placement, unsigned slot,
+                                  const std::string &next_in_layout) {
+            auto &action = placement.state->actions.at(slot);
+            if (placement.observed) {
+                compile_observer_call(jit, *placement.state, slot);
+            }
+            auto stop = placement.stop;
             //Write value to tape:
             jit->emit_mov(Register::RAX, action.write_value);
             //"mov [R10 + R11], al"
             jit->emit(4, "\x43\x88\x04\x1A");
-            //Store name of new state:
-            jit->emit_mov(Register::RAX, jit->symbol("state_name_" + action.next_state));
-            jit->emit_mov(Indirect(Register::R12), Register::RAX);
-            //Store address of new state:
-            jit->emit_mov(Register::RAX, jit->symbol("state_" + action.next_state));
-            jit->emit_mov(Indirect(Register::R14), Register::RAX);
+            //Count ones; only steps that write a one over a zero can cross the limit:
+            if (stop && stop->has_checksum_limit() && action.write_value > slot) {
+                jit->emit_inc(Register::RBX);
+                compile_context_cmp(jit, Register::RBX, offsetof(JitContext, checksum_limit));
+                jit->emit_jcc(Condition::ABOVE,
+                              jit->symbol(state_label(placement.state->name,
+                                                      "stop" + std::to_string(slot))));
+            } else if (stop && stop->has_checksum_limit() && action.write_value < slot) {
+                jit->emit_dec(Register::RBX);
+            }
             //Move tape:
             if (action.move_direction > 0) {
                 jit->emit_inc(Register::R10);
             } else {
                 jit->emit_dec(Register::R10);
             }
-            //return:
-            jit->emit_jmp(jit->symbol(end_label));
-        }
-
-        void compile_state(Jit *jit, const State &state) {
-
-            jit->emit_function("state_" + state.name, 0, [jit,state](auto _, auto _2, auto end_label) {
-                auto if0 = "_state_" + state.name + "_if0";
-                auto if1 = "_state_" + state.name + "_if1";
-                auto cleanup = "_state_" + state.name + "_cleanup";
-                auto fix_offset_underflow = "_state_" + state.name + "_fix_underflow";
-                auto fix_offset_overflow = "_state_" + state.name + "_fix_overflow";
-                auto offset_fixed = "_state_" + state.name + "_offset_fixed";
-                //Local variables:
-                //  R09 &tape_offset
-                //  R10 tape_offset
-                //  R11 &tape
-                //  R12 &state_name
-                //  R13 [unused]
-                //  R14 &state_func
-                //  R15 tape_size
-
-                //Prepare locals
-                jit->emit_mov(Register::R9, jit->symbol("tape_offset"));
-                jit->emit_mov(Register::R10, Indirect(Register::R9));
-                jit->emit_mov(Register::R11, jit->symbol("tape"));
-                jit->emit_mov(Register::R12, jit->symbol("state_name"));
-                jit->emit_mov(Register::R15, jit->symbol("tape_size"));
-                jit->emit_mov(Register::R15, Indirect(Register::R15));
-                jit->emit_mov(Register::R14, jit->symbol("state_func"));
-
-                //Load state from tape
-                jit->emit_mov(Register::RAX, 0);
-                //"mov al, [R10 + R11]" (byte registers are not directly supported by the bytecode builder)
-                jit->emit(4, "\x43\x8A\x04\x1A");
-                jit->emit_cmp(Register::RAX, 0);
-                jit->emit_jcc(Condition::NOT_EQUAL, jit->symbol(if1));
-
-                //Behaviour for tape=0
-                jit->emit_symbol(if0);
-                compile_state_action(jit, state, state.actions.at(0), cleanup);
-
-                //Behaviour for tape=1
-                jit->emit_symbol(if1);
-                compile_state_action(jit, state, state.actions.at(1), cleanup);
-
-                jit->emit_symbol(cleanup);
-
-                //Fixup tape offset in case of under/overflow
-                jit->emit_cmp(Register::R10, 0);
-                jit->emit_jcc(Condition::LESS, jit->symbol(fix_offset_underflow));
-                jit->emit_cmp(Register::R10, Register::R15);
-                jit->emit_jcc(Condition::ABOVE_EQUAL, jit->symbol(fix_offset_overflow));
-                //No fixes required, skip.
-                jit->emit_jmp(jit->symbol(offset_fixed));
-                //Fix underflow
-                jit->emit_symbol(fix_offset_underflow);
-                jit->emit_mov(Register::R10, Register::R15);
-                jit->emit_dec(Register::R10);
-                jit->emit_jmp(jit->symbol(offset_fixed));
-                //Fix overflow
-                jit->emit_symbol(fix_offset_overflow);
-                jit->emit_mov(Register::R10, 0);
-                //Store new tape offset
-                jit->emit_symbol(offset_fixed);
-                jit->emit_mov(Indirect(Register::R9), Register::R10);
-                //Return '0'
-                jit->emit_mov(Register::RAX, 0);
+            //Leave if the head left the tape (an offset of -1 compares above tape_size, too):
+            jit->emit_cmp(Register::R10, Register::R15);
+            jit->emit_jcc(Condition::ABOVE_EQUAL, jit->symbol(state_label(action.next_state, "leave")));
+            //Only the bound in the direction of the move can be crossed:
+            if (stop && stop->has_head_bounds()) {
+                auto positive = action.move_direction > 0;
+                compile_context_cmp(jit, Register::R10,
+                                    positive ? offsetof(JitContext, head_high)
+                                             : offsetof(JitContext, head_low));
+                jit->emit_jcc(positive ? Condition::GREATER : Condition::LESS,
+                              jit->symbol(state_label(action.next_state, "stop_head")));
+            }
+            //Continue with the next state, unless it directly follows:
+            if (stop && action.next_state == stop->state) {
+                jit->emit_jmp(jit->symbol(state_label(action.next_state, "stop_state")));
+            } else if (action.next_state != next_in_layout) {
+                jit->emit_jmp(jit->symbol("state_" + action.next_state));
+            }
+        }
+
+        /** Emit `trace` as the entry of its first state, falling back to the state's own code
+         * (at `_state_<name>_body`) if fewer steps remain than the trace has, or the head is
+         * too close to either end of the tape.
+         */
+        void compile_trace(Jit *jit, const Trace &trace) {
+            auto &name = trace.steps.front().state->name;
+            auto length = (int32_t)trace.steps.size();
+            auto body = jit->symbol(state_label(name, "body"));
+            jit->emit_symbol("state_" + name);
+            jit->emit_cmp(Register::R13, length);
+            jit->emit_jcc(Condition::LESS, body);
+            //All slots the trace accesses must be on the tape (R10 + offset compares above
+            //tape_size if it is negative, too):
+            for (auto offset : {trace.min_offset, trace.max_offset}) {
+                if (offset) {
+                    jit->emit_mov(Register::RAX, Register::R10);
+                    jit->emit_add(Register::RAX, offset);
+                    jit->emit_cmp(Register::RAX, Register::R15);
+                    jit->emit_jcc(Condition::ABOVE_EQUAL, body);
+                }
+            }
+
+            for (size_t i = 0; i < trace.steps.size(); i++) {
+                auto &step = trace.steps[i];
+                if (step.guard) {
+                    //"cmp byte [R10 + R11 + offset], slot"
+                    jit->emit(4, "\x43\x80\xBC\x1A");
+                    jit->emit(step.offset);
+                    jit->emit((uint8_t)step.slot);
+                    jit->emit_jcc(Condition::NOT_EQUAL,
+                                  i ? jit->symbol(state_label(name, "trace_exit" + std::to_string(i)))
+                                    : body);
+                }
+                if (step.store) {
+                    //"mov byte [R10 + R11 + offset], value"
+                    jit->emit(4, "\x43\xC6\x84\x1A");
+                    jit->emit(step.offset);
+                    jit->emit((uint8_t)step.state->actions.at(step.slot).write_value);
+                }
+            }
+            if (trace.displacement) {
+                jit->emit_add(Register::R10, trace.displacement);
+            }
+            jit->emit_sub(Register::R13, length);
+            jit->emit_jmp(jit->symbol("state_" + trace.exit_state));
+
+            //Guard failures: move the head to where the step would have read, and let the
+            //state's own code run it.
+            for (size_t i = 1; i < trace.steps.size(); i++) {
+                auto &step = trace.steps[i];
+                if (!step.guard) {
+                    continue;
+                }
+                jit->emit_symbol(state_label(name, "trace_exit" + std::to_string(i)));
+                if (step.offset) {
+                    jit->emit_add(Register::R10, step.offset);
+                }
+                jit->emit_sub(Register::R13, (int32_t)i);
+                jit->emit_jmp(jit->symbol(state_label(step.state->name, "body")));
+            }
+        }
+
+        void compile_state(Jit *jit, const Placement &placement, const std::string &next_in_layout) {
+            auto &state = *placement.state;
+            auto cold_slot = 1 - placement.hot_slot;
+            if (placement.align) {
+                jit->emit_align(64);
+            }
+            //Predecessors falling through into this state enter the trace, too.
+            if (placement.trace) {
+                compile_trace(jit, *placement.trace);
+            } else {
+                jit->emit_symbol("state_" + state.name);
+            }
+            jit->emit_symbol(state_label(state.name, "body"));
+            //Leave if no steps remain:
+            jit->emit_dec(Register::R13);
+            jit->emit_jcc(Condition::SIGN, jit->symbol(state_label(state.name, "exhausted")));
+
+            //Load state from tape
+            jit->emit_mov(Register::RAX, 0);
+            //"mov al, [R10 + R11]" (byte registers are not directly supported by the bytecode builder)
+            jit->emit(4, "\x43\x8A\x04\x1A");
+            jit->emit_cmp(Register::RAX, 0);
+            jit->emit_jcc(cold_slot ? Condition::NOT_EQUAL : Condition::EQUAL,
+                          jit->symbol(state_label(state.name, "if" + std::to_string(cold_slot))));
+
+            compile_state_action(jit, placement, placement.hot_slot,
+                                 placement.cold_inline ? "" : next_in_layout);
+            if (placement.cold_inline) {
+                jit->emit_symbol(state_label(state.name, "if" + std::to_string(cold_slot)));
+                compile_state_action(jit, placement, cold_slot, next_in_layout);
+            }
+        }
+
+        void compile_cold_path(Jit *jit, const Placement &placement) {
+            auto &state = *placement.state;
+            auto cold_slot = 1 - placement.hot_slot;
+            jit->emit_symbol(state_label(state.name, "if" + std::to_string(cold_slot)));
+            compile_state_action(jit, placement, cold_slot, "");
+        }
+
+        void compile_state_exit(Jit *jit, const State &state, const StopConditions *stop) {
+            if (stop && stop->has_head_bounds()) {
+                jit->emit_symbol(state_label(state.name, "stop_head"));
+                compile_stop(jit, StopReason::HEAD, state.name);
+            }
+            if (stop && stop->state == state.name) {
+                jit->emit_symbol(state_label(state.name, "stop_state"));
+                compile_stop(jit, StopReason::STATE, state.name);
+            }
+            //The step that was about to run in this state is not executed after all:
+            jit->emit_symbol(state_label(state.name, "exhausted"));
+            jit->emit_inc(Register::R13);
+            //Store name and address of the state to continue in next time:
+            jit->emit_symbol(state_label(state.name, "leave"));
+            jit->emit_mov(Register::RAX, jit->symbol("state_name_" + state.name));
+            jit->emit_mov(Indirect(Register::R12), Register::RAX);
+            jit->emit_mov(Register::RAX, jit->symbol("state_" + state.name));
+            jit->emit_mov(Indirect(Register::R14), Register::RAX);
+            jit->emit_jmp(jit->symbol("_run_finish"));
+        }
+
+        /** Emit new code for `state` behind the existing code.
+         *
+         * The old code, if any, becomes unreachable: its entry jumps to the new code,
+         * for predecessors that fall through into it and contexts that stopped in it.
+         */
+        void patch_state(Jit *jit, const Program &program, const std::string &name, bool observed,
+                         const StopConditions *stop) {
+            auto &entry = *program.states.find(name);
+            auto &state = entry.second;
+            auto old_entry = jit->symbol("state_" + state.name);
+            for (auto part : {"body", "if0", "if1", "stop0", "stop1"}) {
+                jit->undefine_symbol(state_label(state.name, part));
+            }
+            jit->undefine_symbol("state_" + state.name);
+            // Every transition jumps explicitly, nothing follows in the layout.
+            compile_state(jit, Placement{&state, 0, true, false, nullptr, observed, stop}, "");
+            if (stop && stop->has_checksum_limit()) {
+                compile_checksum_exits(jit, state);
+            }
+            if (old_entry.address) {
+                jit->patch_jmp(old_entry, jit->symbol("state_" + state.name));
+            } else {
+                jit->emit_symbol("state_name_" + state.name, (void *)entry.first.c_str());
+                compile_state_exit(jit, state, stop);
+            }
+        }
+
+        std::vector<Placement> default_layout(const Program &program) {
+            std::vector<Placement> layout;
+            for (auto &it : program.states) {
+                layout.push_back(Placement{&it.second, 0, true, false, nullptr, false, nullptr});
+            }
+            return layout;
+        }
+
+        std::vector<Placement> profiled_layout(const Program &program, const Profile &profile) {
+            std::vector<const State *> by_count;
+            for (auto &it : program.states) {
+                by_count.push_back(&it.second);
+            }
+            std::stable_sort(by_count.begin(), by_count.end(), [&profile](auto a, auto b) {
+                return profile.count(a->name) > profile.count(b->name);
             });
-            jit->add_constant("state_name_" + state.name, state.name);
+
+            //Starting with the hottest state not yet placed, follow the likely successors
+            //to build chains of states that fall through into each other.
+            std::vector<Placement> layout;
+            std::set<std::string> placed;
+            for (auto state : by_count) {
+                bool chain_start = true;
+                while (!placed.count(state->name)) {
+                    auto hot = profile.count(state->name) > 0;
+                    auto hot_slot = profile.likely_slot(state->name);
+                    placed.insert(state->name);
+                    layout.push_back(
+                        Placement{state, hot_slot, !hot, chain_start && hot, nullptr, false, nullptr});
+                    chain_start = false;
+                    auto &next = state->actions.at(hot_slot).next_state;
+                    if (!hot || !profile.count(next)) {
+                        break;
+                    }
+                    state = &program.states.at(next);
+                }
+            }
+            return layout;
         }
     } // namespace
 
-    JitExecutor::JitExecutor(Program program) : m_program(program), m_jit(new Jit), m_tape_size(m_program.checksum_delay) {
-        m_tape = new uint8_t[m_tape_size];
-        compile();
-        reset();
+    uint32_t jit_code_size(const Program &program, const Profile *profile, bool traces,
+                           bool observed, const StopConditions &stop) {
+        // Each state needs up to ~170 bytes of code and up to 63 bytes of alignment.
+        uint64_t size = program.states.size() * state_code_size(observed, stop) + 4096;
+        if (profile && traces && !observed && !compiles_stop(stop)) {
+            size += plan_traces(program, *profile).size() * TRACE_CODE_SIZE;
+        }
+        size = (size + 4095) & ~4095ull;
+        if (size > UINT32_MAX) {
+            throw std::runtime_error("Program too large for the JIT.");
+        }
+        return size;
     }
 
-    JitExecutor::~JitExecutor() {
-        delete[] m_tape;
-        delete m_jit;
+    void emit_program(Jit *jit, const Program &program, const Profile *profile, bool traces,
+                      bool observed, const StopConditions &stop) {
+        // Map keys keep their address while states are added or replaced.
+        for (auto &it : program.states) {
+            jit->emit_symbol("state_name_" + it.first, (void *)it.first.c_str());
+        }
+        auto layout = profile ? profiled_layout(program, *profile) : default_layout(program);
+        std::map<std::string, Trace> planned;
+        // Traces run many steps at once, so they cannot report or check single steps.
+        auto checked = compiles_stop(stop) ? &stop : nullptr;
+        if (profile && traces && !observed && !checked) {
+            planned = plan_traces(program, *profile);
+            for (auto &placement : layout) {
+                auto trace = planned.find(placement.state->name);
+                if (trace != planned.end()) {
+                    placement.trace = &trace->second;
+                }
+            }
+        }
+        for (auto &placement : layout) {
+            placement.observed = observed;
+            placement.stop = checked;
+        }
+
+        //Point `reg` at a field of the JitContext passed in RDI.
+        auto context_field = [jit](Register reg, size_t offset) {
+            jit->emit_mov(reg, Register::RDI);
+            jit->emit_add(reg, (int8_t)offset);
+        };
+        auto count_ones = checked && stop.has_checksum_limit();
+
+        jit->emit_function("run", 0, [&](auto _, auto _2, auto end_label) {
+            //Prepare locals
+            jit->emit_mov(Register::R13, Register::RSI);
+            context_field(Register::R9, offsetof(JitContext, tape_offset));
+            jit->emit_mov(Register::R10, Indirect(Register::R9));
+            context_field(Register::R11, offsetof(JitContext, tape));
+            jit->emit_mov(Register::R11, Indirect(Register::R11));
+            context_field(Register::R12, offsetof(JitContext, state_name));
+            context_field(Register::R15, offsetof(JitContext, tape_size));
+            jit->emit_mov(Register::R15, Indirect(Register::R15));
+            context_field(Register::R14, offsetof(JitContext, state_func));
+            if (count_ones) {
+                context_field(Register::RBX, offsetof(JitContext, ones));
+                jit->emit_mov(Register::RBX, Indirect(Register::RBX));
+            }
+
+            //Continue in the current state:
+            jit->emit_mov(Register::RAX, Indirect(Register::R14));
+            jit->emit_jmp(Register::RAX);
+
+            for (size_t i = 0; i < layout.size(); i++) {
+                //Falling through across alignment padding is not possible.
+                std::string next_in_layout;
+                if (i + 1 < layout.size() && !layout[i + 1].align) {
+                    next_in_layout = layout[i + 1].state->name;
+                }
+                compile_state(jit, layout[i], next_in_layout);
+            }
+            for (auto &placement : layout) {
+                if (!placement.cold_inline) {
+                    compile_cold_path(jit, placement);
+                }
+            }
+            for (auto &it : program.states) {
+                if (count_ones) {
+                    compile_checksum_exits(jit, it.second);
+                }
+                compile_state_exit(jit, it.second, checked);
+            }
+
+            //Store new tape offset and return the number of remaining steps:
+            jit->emit_symbol("_run_finish");
+            jit->emit_mov(Indirect(Register::R9), Register::R10);
+            if (count_ones) {
+                compile_context_field(jit, Register::RAX, offsetof(JitContext, ones));
+                jit->emit_mov(Indirect(Register::RAX), Register::RBX);
+            }
+            jit->emit_mov(Register::RAX, Register::R13);
+        });
     }
 
-    void JitExecutor::compile() {
-        m_jit->emit_symbol("tape", m_tape);
-        m_jit->emit_symbol("tape_size", &m_tape_size);
-        m_jit->emit_symbol("tape_offset",&m_tape_offset);
-        m_jit->emit_symbol("state_name", &m_state_name);
-        m_jit->emit_symbol("state_func", &m_state_func);
-        auto state = m_program.states.at(m_program.initial_state);
-        for (auto it : m_program.states) {
-            compile_state(m_jit, it.second);
+    JitProgram::JitProgram(Program program, const Profile *profile, const PagePolicy &pages,
+                           bool traces, bool observed, const StopConditions &stop)
+        : CompiledProgram(program),
+          m_jit(new Jit(jit_code_size(program, profile, traces, observed, stop), pages)),
+          m_pages(pages), m_generation(0),
+          m_traced(profile && traces && !observed && !compiles_stop(stop)),
+          m_observed(observed), m_stop(stop) {
+        if (stop.has_state() && !this->program().states.count(stop.state)) {
+            throw std::runtime_error("Unknown stop state " + stop.state);
         }
+        emit_program(m_jit.get(), this->program(), profile, traces, observed, stop);
         m_jit->finalize_code();
+        m_run = (uint64_t(*)(JitContext*, uint64_t)) (m_jit->symbol("run").address);
     }
 
-    void JitExecutor::dump_state() {
-        cout << "State: " <<
-             "idx=" << m_tape_offset << "; "
-             << "state=" << m_state_name << "; "
-             << "tape=";
-        for (uint64_t i = 0; i < m_tape_size; i++) {
-            cout << (int)(m_tape[i]);
+    void JitProgram::patch_states(const std::vector<State> &states) {
+        auto &program = mutable_program();
+        std::set<std::string> names;
+        for (auto &state : states) {
+            names.insert(state.name);
+        }
+        for (auto &state : states) {
+            for (unsigned slot = 0; slot <= 1; slot++) {
+                auto action = state.actions.find(slot);
+                if (action == state.actions.end()) {
+                    throw std::runtime_error("State " + state.name + " has no action for value " +
+                                             std::to_string(slot));
+                }
+                auto &next = action->second.next_state;
+                if (!program.states.count(next) && !names.count(next)) {
+                    throw std::runtime_error("Undefined state " + next);
+                }
+            }
+        }
+
+        // Assigning keeps the other states' links to replaced states valid.
+        for (auto &state : states) {
+            program.states[state.name] = state;
+        }
+        for (auto &state : states) {
+            program.link_state(program.states.at(state.name));
+        }
+
+        // Traces may run through the replaced states, so they are compiled again without.
+        auto room = m_jit->code_size() - m_jit->code_used();
+        if (!m_traced && room > states.size() * state_code_size(m_observed, m_stop)) {
+            m_jit->reopen_code();
+            for (auto &state : states) {
+                patch_state(m_jit.get(), program, state.name, m_observed,
+                            compiles_stop(m_stop) ? &m_stop : nullptr);
+            }
+            m_jit->finalize_code();
+        } else {
+            uint64_t size = 2ull * jit_code_size(program, nullptr, false, m_observed, m_stop);
+            std::unique_ptr<Jit> jit(new Jit(std::min<uint64_t>(size, UINT32_MAX), m_pages));
+            emit_program(jit.get(), program, nullptr, false, m_observed, m_stop);
+            jit->finalize_code();
+            m_jit = std::move(jit);
+            m_traced = false;
+            m_run = (uint64_t(*)(JitContext*, uint64_t)) (m_jit->symbol("run").address);
+            m_generation++;
         }
-        cout << endl;
     }
 
+    std::shared_ptr<Executor> JitProgram::instantiate(const ExecutorOptions &options) const {
+        if (options.observer && !m_observed) {
+            throw std::runtime_error("Program was compiled without observer calls.");
+        }
+        return std::make_shared<JitExecutor>(
+            std::static_pointer_cast<const JitProgram>(shared_from_this()), options);
+    }
+
+    MemoryUsage JitProgram::memory_usage() const {
+        MemoryUsage usage;
+        usage.code_reserved = m_jit->mapped_size();
+        usage.code_used = m_jit->code_used();
+        usage.jit_data = m_jit->data_size();
+        return usage;
+    }
+
+    void JitProgram::enter_state(JitContext &context, const std::string &state) const {
+        context.state_name = (const char*)m_jit->symbol("state_name_" + state).address;
+        context.state_func = (void*)m_jit->symbol("state_" + state).address;
+    }
+
+    JitExecutor::JitExecutor(Program program, const ExecutorOptions &options)
+        : JitExecutor(std::make_shared<JitProgram>(program, nullptr, PagePolicy(), false, false,
+                                                   options.stop),
+                      options) {}
+
+    JitExecutor::JitExecutor(Program program, const ExecutorOptions &options, const Profile &profile)
+        : JitExecutor(std::make_shared<JitProgram>(program, &profile, PagePolicy(), false, false,
+                                                   options.stop),
+                      options) {}
+
+    JitExecutor::JitExecutor(std::shared_ptr<const JitProgram> compiled, const ExecutorOptions &options)
+        : m_compiled(compiled),
+          m_tape_memory(compiled->program().checksum_delay, options.tape_file, options.tape_advice,
+                        options.pages) {
+        if (!(options.stop == compiled->stop_conditions())) {
+            throw std::runtime_error("Program was compiled for other stop conditions.");
+        }
+        m_context.observer = options.observer;
+        m_context.checksum_limit = options.stop.checksum_limit;
+        reset();
+    }
+
+    JitExecutor::~JitExecutor() {}
+
     void JitExecutor::step() {
-        m_state_func();
-        //dump_state();
+        run(1);
+    }
+
+    void JitExecutor::run(uint64_t steps) {
+        if (m_generation != m_compiled->generation()) {
+            // The program was compiled again; the state name points into the program.
+            m_compiled->enter_state(m_context, m_context.state_name);
+            m_generation = m_compiled->generation();
+        }
+        m_stop_event = StopEvent();
+        auto &stop = m_compiled->stop_conditions();
+        while (steps) {
+            // Never run past the next step multiple, so it needs no check in the code.
+            auto chunk = std::min<uint64_t>(stop.steps_to_multiple(m_steps, steps), INT64_MAX);
+            m_context.stop_reason = (uint64_t)StopReason::NONE;
+            auto executed = chunk - m_compiled->run(m_context, chunk);
+            m_steps += executed;
+            steps -= executed;
+            auto reason = (StopReason)m_context.stop_reason;
+            if (m_context.tape_offset >= m_context.tape_size) {
+                auto left = m_context.tape_offset == UINT64_MAX;
+                // The head keeps its position when the tape grows or wraps around.
+                auto position = (int64_t)(m_context.tape_offset - m_origin);
+                if (left) {
+                    m_context.tape_offset = m_tape_memory.extend_left();
+                } else {
+                    m_context.tape_offset = m_tape_memory.extend_right();
+                }
+                m_context.tape = m_tape_memory.data();
+                m_context.tape_size = m_tape_memory.size();
+                m_origin = m_context.tape_offset - position;
+                update_stop_bounds();
+                // The code returned before checking the step that left the tape.
+                if (reason == StopReason::NONE &&
+                    (left ? position < stop.head_min : position > stop.head_max)) {
+                    reason = StopReason::HEAD;
+                }
+                if (reason == StopReason::NONE && stop.state == m_context.state_name) {
+                    reason = StopReason::STATE;
+                }
+            }
+            if (reason == StopReason::NONE && stop.step_multiple && executed &&
+                m_steps % stop.step_multiple == 0) {
+                reason = StopReason::STEP_MULTIPLE;
+            }
+            if (reason != StopReason::NONE) {
+                m_stop_event = StopEvent{reason, m_steps};
+                return;
+            }
+        }
+    }
+
+    void JitExecutor::update_stop_bounds() {
+        auto &stop = m_compiled->stop_conditions();
+        // Saturate, so that bounds beyond the address range never hold.
+        auto bound = [this](int64_t position) {
+            int64_t offset;
+            if (__builtin_add_overflow((int64_t)m_origin, position, &offset)) {
+                return position < 0 ? INT64_MIN : INT64_MAX;
+            }
+            return offset;
+        };
+        m_context.head_low = bound(stop.head_min);
+        m_context.head_high = bound(stop.head_max);
     }
 
     void JitExecutor::reset() {
-        m_state_name = (char*)m_jit->symbol("state_name_" + m_program.initial_state).address;
-        m_state_func = (void(*)()) (m_jit->symbol("state_" + m_program.initial_state).address);
-        m_tape_offset = 0;
-        memset((void*)(m_jit->symbol("tape").address), 0, m_program.checksum_delay);
-        //dump_state();
+        m_compiled->enter_state(m_context, m_compiled->program().initial_state);
+        m_generation = m_compiled->generation();
+        m_steps = 0;
+        m_tape_memory.clear();
+        m_context.tape = m_tape_memory.data();
+        m_context.tape_size = m_tape_memory.size();
+        m_context.tape_offset = m_tape_memory.origin();
+        m_context.ones = 0;
+        m_origin = m_context.tape_offset;
+        update_stop_bounds();
+    }
+
+    uint64_t JitExecutor::diagnostic_checksum() {
+        return m_tape_memory.checksum();
+    }
+
+    uint64_t JitExecutor::head() const { return m_context.tape_offset; }
+
+    uint64_t JitExecutor::tape_size() const { return m_tape_memory.size(); }
+
+    MemoryUsage JitExecutor::memory_usage(bool measure_touched) const {
+        auto usage = m_compiled->memory_usage();
+        add_tape_usage(usage, m_tape_memory, measure_touched);
+        return usage;
+    }
+
+    std::string JitExecutor::state() const { return m_context.state_name; }
+
+    MachineState JitExecutor::machine_state() const {
+        return MachineState{
+            .tape = m_tape_memory.contents(),
+            .head = m_context.tape_offset,
+            .state = m_context.state_name,
+            .steps = m_steps,
+        };
     }
 
-    uint32_t JitExecutor::diagnostic_checksum() {
-        uint32_t checksum = 0;
-        for (uint32_t i = 0; i < m_tape_size; i++) {
-            checksum += m_tape[i];
+    void JitExecutor::restore_machine_state(const MachineState &state) {
+        if (!m_compiled->program().states.count(state.state)) {
+            throw std::runtime_error("Checkpoint does not match program.");
         }
-        return checksum;
+        m_tape_memory.assign(state.tape);
+        m_context.tape = m_tape_memory.data();
+        m_context.tape_size = m_tape_memory.size();
+        m_context.tape_offset = state.head;
+        m_context.ones = m_compiled->stop_conditions().has_checksum_limit() ? m_tape_memory.checksum() : 0;
+        m_origin = state.head;
+        update_stop_bounds();
+        m_compiled->enter_state(m_context, state.state);
+        m_generation = m_compiled->generation();
+        m_steps = state.steps;
     }
 } // namespace day25
\ No newline at end of file
@@ -0,0 +1,192 @@
+#include "packed_executor.hpp"
+#include <stdexcept>
+
+namespace day25 {
+PackedProgram::PackedProgram(Program program) : BytecodeProgram(program) {
+    uint32_t states = this->program().states.size();
+    if (states > MAX_STATES) {
+        throw std::runtime_error(
+            "Packed executor only works with up to 1024 states!");
+    }
+
+    // Each configuration of state, byte and head position leads to exactly
+    // one other, so the transitions are built by following configurations
+    // until the head leaves the byte, a configuration that is already known
+    // is reached, or the path runs into itself. All configurations on the
+    // path are then filled in from the end.
+    enum : uint8_t { UNKNOWN, VISITING, DONE };
+    m_transitions.resize(states * 2048);
+    std::vector<uint8_t> status(m_transitions.size(), UNKNOWN);
+    std::vector<uint32_t> path;
+    for (uint32_t start = 0; start < m_transitions.size(); start++) {
+        PackedTransition result{};
+        bool loops = false;
+        uint32_t config = start;
+        while (true) {
+            if (status[config] == DONE) {
+                result = m_transitions[config];
+                loops = result.steps == 0;
+                break;
+            }
+            if (status[config] == VISITING) {
+                loops = true;
+                break;
+            }
+            status[config] = VISITING;
+            path.push_back(config);
+
+            uint32_t state = config / 2048;
+            uint8_t byte = (config / 8) % 256;
+            unsigned position = config % 8;
+            auto bytecode = code()[state];
+            uint32_t encoded_action = ((byte >> position) & 1)
+                                          ? (bytecode >> 32) & 0xffffffff
+                                          : bytecode & 0xffffffff;
+            uint8_t write_contents;
+            int8_t move_direction;
+            uint32_t next_state;
+            decode_action(encoded_action, write_contents, move_direction,
+                          next_state);
+            byte = (byte & ~(1u << position)) | (write_contents << position);
+            int next_position = position + move_direction;
+            if (next_position < 0 || next_position > 7) {
+                result = PackedTransition{
+                    .next_state = next_state,
+                    .steps = 0,
+                    .byte = byte,
+                    .exit_direction = move_direction,
+                };
+                break;
+            }
+            config = (next_state * 256 + byte) * 8 + next_position;
+        }
+        for (auto it = path.rbegin(); it != path.rend(); it++) {
+            if (loops) {
+                m_transitions[*it] = PackedTransition{};
+            } else {
+                result.steps++;
+                m_transitions[*it] = result;
+            }
+            status[*it] = DONE;
+        }
+        path.clear();
+    }
+}
+
+std::shared_ptr<Executor>
+PackedProgram::instantiate(const ExecutorOptions &options) const {
+    // Steps inside a byte are never run one by one.
+    if (options.observer) {
+        throw std::runtime_error("The packed executor does not support observers.");
+    }
+    if (options.stop.active()) {
+        throw std::runtime_error(
+            "The packed executor does not support stop conditions.");
+    }
+    return std::make_shared<PackedExecutor>(
+        std::static_pointer_cast<const PackedProgram>(shared_from_this()),
+        options);
+}
+
+MemoryUsage PackedProgram::memory_usage() const {
+    auto usage = BytecodeProgram::memory_usage();
+    usage.tables += m_transitions.size() * sizeof(PackedTransition);
+    return usage;
+}
+
+PackedExecutor::PackedExecutor(Program program, const ExecutorOptions &options)
+    : PackedExecutor(std::make_shared<PackedProgram>(program), options) {}
+
+PackedExecutor::PackedExecutor(std::shared_ptr<const PackedProgram> compiled,
+                               const ExecutorOptions &options)
+    : m_compiled(compiled),
+      m_tape(compiled->program().checksum_delay, options.tape_file,
+             options.tape_advice,
+             options.pages) {
+    reset();
+}
+
+PackedExecutor::~PackedExecutor() {}
+
+void PackedExecutor::reset() {
+    m_tape.clear();
+    m_head = m_tape.origin();
+    m_state = m_compiled->initial_state();
+    m_steps = 0;
+}
+
+void PackedExecutor::step() {
+    auto bytecode = m_compiled->code()[m_state];
+    uint32_t encoded_action = m_tape.get(m_head)
+                                  ? (bytecode >> 32) & 0xffffffff
+                                  : bytecode & 0xffffffff;
+    uint8_t write_contents;
+    int8_t move_direction;
+    uint32_t next_state;
+    BytecodeProgram::decode_action(encoded_action, write_contents,
+                                   move_direction, next_state);
+    m_tape.set(m_head, write_contents);
+    m_head = m_tape.move(m_head, move_direction);
+    m_state = next_state;
+    m_steps++;
+}
+
+void PackedExecutor::run(uint64_t steps) {
+    auto remaining = steps;
+    while (remaining > 0) {
+        auto byte_index = m_head / 8;
+        auto &transition = m_compiled->transition(
+            m_state, m_tape.data()[byte_index], m_head % 8);
+        // The last byte of a tape that is not a multiple of 8 slots long
+        // wraps around within the byte, which the table does not know about.
+        if (transition.steps == 0 || transition.steps > remaining ||
+            (byte_index + 1) * 8 > m_tape.size()) {
+            step();
+            remaining--;
+            continue;
+        }
+        m_tape.data()[byte_index] = transition.byte;
+        m_state = transition.next_state;
+        auto last_slot = transition.exit_direction < 0 ? byte_index * 8
+                                                       : byte_index * 8 + 7;
+        m_head = m_tape.move(last_slot, transition.exit_direction);
+        remaining -= transition.steps;
+        m_steps += transition.steps;
+    }
+}
+
+uint64_t PackedExecutor::diagnostic_checksum() { return m_tape.checksum(); }
+
+uint64_t PackedExecutor::head() const { return m_head; }
+
+uint64_t PackedExecutor::tape_size() const { return m_tape.size(); }
+
+MemoryUsage PackedExecutor::memory_usage(bool measure_touched) const {
+    auto usage = m_compiled->memory_usage();
+    add_tape_usage(usage, m_tape, measure_touched);
+    return usage;
+}
+
+std::string PackedExecutor::state() const {
+    return m_compiled->state_name(m_state);
+}
+
+MachineState PackedExecutor::machine_state() const {
+    return MachineState{
+        .tape = m_tape.contents(),
+        .head = m_head,
+        .state = m_compiled->state_name(m_state),
+        .steps = m_steps,
+    };
+}
+
+void PackedExecutor::restore_machine_state(const MachineState &state) {
+    if (!m_compiled->has_state(state.state)) {
+        throw std::runtime_error("Checkpoint does not match program.");
+    }
+    m_tape.assign(state.tape);
+    m_head = state.head;
+    m_state = m_compiled->state_index(state.state);
+    m_steps = state.steps;
+}
+} // namespace day25
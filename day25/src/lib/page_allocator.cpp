@@ -0,0 +1,61 @@
+#include "page_allocator.hpp"
+#include <linux/mempolicy.h>
+#include <sched.h>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+using std::runtime_error;
+
+namespace day25 {
+PageMapping map_pages(uint64_t size, const PagePolicy &policy, int prot) {
+    int flags = MAP_ANONYMOUS | MAP_PRIVATE;
+    // mmap refuses zero-length mappings.
+    size = size ? size : 1;
+    if (policy.huge_pages == HugePages::EXPLICIT && size >= HUGE_PAGE_SIZE) {
+        auto huge_size =
+            (size + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE * HUGE_PAGE_SIZE;
+        auto mapped = mmap(nullptr, huge_size, prot, flags | MAP_HUGETLB, -1, 0);
+        if (mapped != MAP_FAILED) {
+            apply_page_policy(mapped, huge_size, policy);
+            return PageMapping{
+                .address = mapped,
+                .size = huge_size,
+                .huge = true,
+            };
+        }
+        // The huge page pool is empty or too small.
+    }
+    auto mapped = mmap(nullptr, size, prot, flags, -1, 0);
+    if (mapped == MAP_FAILED) {
+        throw runtime_error("Could not map memory.");
+    }
+    apply_page_policy(mapped, size, policy);
+    return PageMapping{
+        .address = mapped,
+        .size = size,
+        .huge = false,
+    };
+}
+
+void apply_page_policy(void *address, uint64_t size, const PagePolicy &policy) {
+    if (policy.huge_pages != HugePages::NONE) {
+        madvise(address, size, MADV_HUGEPAGE);
+    }
+    if (policy.numa_node >= 0 && policy.numa_node < 64) {
+        // Called directly, so the library does not depend on libnuma.
+        unsigned long nodes = 1ul << policy.numa_node;
+        syscall(SYS_mbind, address, size, MPOL_PREFERRED, &nodes,
+                sizeof(nodes) * 8, 0);
+    }
+}
+
+int current_numa_node() {
+    unsigned cpu, node;
+    if (syscall(SYS_getcpu, &cpu, &node, nullptr)) {
+        return -1;
+    }
+    return node;
+}
+} // namespace day25
@@ -37,7 +37,7 @@ const ParserState &Parser::parse() {
                 return error(token, "Multiple checksum declarations.");
             } else {
                 checksum_delay_seen = true;
-                m_program.checksum_delay = std::stoul(token.arg);
+                m_program.checksum_delay = std::stoull(token.arg);
             }
 
         } else if (token.type == Token::STATE_DECLARATION) {
@@ -109,6 +109,7 @@ const ParserState &Parser::finalize_program(const Token &eof_token) {
                                     m_program.initial_state +
                                     ", which does not exist.");
     }
+    m_program.link();
     return eof(eof_token);
 }
 
@@ -0,0 +1,106 @@
+#include "profile.hpp"
+#include "tape.hpp"
+#include <unordered_map>
+#include <vector>
+
+using std::string;
+using std::vector;
+
+namespace day25 {
+uint64_t Profile::count(const string &state, unsigned slot) const {
+    auto it = transitions.find(state);
+    if (it == transitions.end()) {
+        return 0;
+    }
+    return it->second[slot];
+}
+
+uint64_t Profile::count(const string &state) const {
+    return count(state, 0) + count(state, 1);
+}
+
+unsigned Profile::likely_slot(const string &state) const {
+    return count(state, 1) > count(state, 0) ? 1 : 0;
+}
+
+std::pair<uint32_t, double> Profile::likely_path(const string &state) const {
+    auto it = paths.find(state);
+    if (it == paths.end()) {
+        return {0, 0};
+    }
+    uint64_t total = 0;
+    std::pair<uint32_t, uint64_t> best(0, 0);
+    for (auto &path : it->second) {
+        total += path.second;
+        if (path.second > best.second) {
+            best = path;
+        }
+    }
+    return {best.first, (double)best.second / total};
+}
+
+Profile collect_profile(const Program &program, uint64_t steps) {
+    // An indexed copy of the program, so the instrumented run does not pay
+    // for name lookups.
+    struct Action {
+        uint8_t write_value;
+        int8_t move_direction;
+        uint32_t next_state;
+    };
+    std::map<string, uint32_t> indexes;
+    vector<string> names;
+    for (auto state : program.states) {
+        indexes[state.first] = names.size();
+        names.push_back(state.first);
+    }
+    vector<Action> actions;
+    for (auto state : program.states) {
+        for (unsigned slot = 0; slot <= 1; slot++) {
+            auto &action = state.second.actions.at(slot);
+            actions.push_back(Action{
+                .write_value = (uint8_t)action.write_value,
+                .move_direction = (int8_t)action.move_direction,
+                .next_state = indexes.at(action.next_state),
+            });
+        }
+    }
+
+    vector<uint64_t> counts(actions.size());
+    vector<std::unordered_map<uint32_t, uint64_t>> paths(names.size());
+    uint32_t path_start = 0, path = 0;
+    unsigned path_length = 0;
+    Tape tape(program.checksum_delay);
+    uint64_t head = tape.origin();
+    uint32_t state = indexes.at(program.initial_state);
+    for (uint64_t i = 0; i < steps; i++) {
+        auto index = state * 2 + tape[head];
+        auto &action = actions[index];
+        counts[index]++;
+        if (path_length == 0) {
+            path_start = state;
+            path = 0;
+        }
+        path |= (uint32_t)tape[head] << path_length;
+        if (++path_length == PROFILE_PATH_LENGTH) {
+            paths[path_start][path]++;
+            path_length = 0;
+        }
+        tape[head] = action.write_value;
+        head += action.move_direction;
+        if (head >= tape.size()) {
+            head = action.move_direction < 0 ? tape.extend_left()
+                                             : tape.extend_right();
+        }
+        state = action.next_state;
+    }
+
+    Profile profile;
+    for (uint32_t i = 0; i < names.size(); i++) {
+        profile.transitions[names[i]] = {counts[i * 2], counts[i * 2 + 1]};
+        if (!paths[i].empty()) {
+            profile.paths[names[i]].insert(paths[i].begin(), paths[i].end());
+        }
+    }
+    return profile;
+}
+} // namespace day25
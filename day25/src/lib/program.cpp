@@ -1,10 +1,58 @@
 #include "program.hpp"
 #include <iostream>
+#include <stdexcept>
 using std::endl;
 using std::ostream;
 using std::string;
 
 namespace day25 {
+Program::Program(const Program &other)
+    : initial_state(other.initial_state),
+      checksum_delay(other.checksum_delay), states(other.states) {
+    if (other.initial_state_link) {
+        link();
+    }
+}
+
+Program &Program::operator=(const Program &other) {
+    initial_state = other.initial_state;
+    checksum_delay = other.checksum_delay;
+    states = other.states;
+    initial_state_link = nullptr;
+    if (other.initial_state_link) {
+        link();
+    }
+    return *this;
+}
+
+void Program::link() {
+    for (auto &state : states) {
+        link_state(state.second);
+    }
+    initial_state_link = find_state(initial_state);
+}
+
+void Program::link_state(State &state) {
+    for (unsigned slot = 0; slot <= 1; slot++) {
+        auto it = state.actions.find(slot);
+        if (it == state.actions.end()) {
+            throw std::runtime_error("State " + state.name +
+                                     " has no action for value " +
+                                     std::to_string(slot));
+        }
+        it->second.next_state_link = find_state(it->second.next_state);
+        state.action_links[slot] = &it->second;
+    }
+}
+
+const State *Program::find_state(const string &name) const {
+    auto it = states.find(name);
+    if (it == states.end()) {
+        throw std::runtime_error("Undefined state " + name);
+    }
+    return &it->second;
+}
+
 ostream &operator<<(ostream &os, const Program &program) {
     os << "Program:" << endl
        << "  Initial state: " << program.initial_state << endl
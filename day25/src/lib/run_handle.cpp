@@ -0,0 +1,105 @@
+#include "executor.hpp"
+#include <algorithm>
+
+namespace day25 {
+namespace {
+/** Number of steps, up to `steps`, that `executor` can run without exceeding
+ * `limit` bytes.
+ *
+ * The head moves one slot per step, and the tape doubles whenever the head
+ * passes either end. Steps that cannot reach either end are always safe;
+ * beyond that, growing the tape k times costs 2^k - 1 times its current
+ * memory and makes room for 2^k - 1 times its current size in steps.
+ */
+uint64_t steps_within_limit(const Executor &executor, uint64_t steps,
+                            uint64_t limit) {
+    auto usage = executor.memory_usage(false);
+    if (usage.total() > limit) {
+        return 0;
+    }
+    auto available = limit - usage.total();
+    auto growth = usage.tape_maximum -
+                  std::min(usage.tape_maximum, usage.tape_reserved);
+    if (growth <= available || usage.tape_reserved == 0) {
+        return steps;
+    }
+    uint64_t factor = 1;
+    while (usage.tape_reserved * (factor * 2 - 1) <= available) {
+        factor *= 2;
+    }
+    auto size = executor.tape_size();
+    auto head = executor.head();
+    auto safe = std::max(std::min(head, size - 1 - head), size * (factor - 1));
+    return std::min(steps, safe);
+}
+} // namespace
+
+void RunHandle::cancel() { m_shared->cancelled = true; }
+
+RunProgress RunHandle::progress() const {
+    return RunProgress{
+        .steps_done = m_shared->steps_done,
+        .steps_requested = m_shared->steps_requested,
+        .steps_per_second = m_shared->steps_per_second,
+    };
+}
+
+bool RunHandle::done() const {
+    return m_result.wait_for(std::chrono::seconds(0)) ==
+           std::future_status::ready;
+}
+
+RunResult RunHandle::wait() const { return m_result.get(); }
+
+RunHandle Executor::run_async(uint64_t steps, const RunOptions &options) {
+    typedef RunOptions::Clock Clock;
+    RunHandle handle;
+    handle.m_shared = std::make_shared<RunHandle::Shared>();
+    handle.m_shared->steps_requested = steps;
+    auto shared = handle.m_shared;
+    auto interval = std::max<uint64_t>(options.check_interval, 1);
+    handle.m_result =
+        std::async(std::launch::async, [this, steps, options, shared,
+                                        interval] {
+            uint64_t done = 0;
+            while (done < steps) {
+                if (shared->cancelled) {
+                    return RunResult::CANCELLED;
+                }
+                auto start = Clock::now();
+                if (start >= options.deadline) {
+                    return RunResult::DEADLINE_EXCEEDED;
+                }
+                auto block = std::min(interval, steps - done);
+                if (options.memory_limit) {
+                    block = steps_within_limit(*this, block,
+                                               options.memory_limit);
+                    if (block == 0) {
+                        return RunResult::MEMORY_LIMIT_EXCEEDED;
+                    }
+                }
+                auto before = steps_executed();
+                run(block);
+                auto executed = steps_executed() - before;
+                done += executed;
+                std::chrono::duration<double> elapsed = Clock::now() - start;
+                shared->steps_done = done;
+                if (elapsed.count() > 0) {
+                    shared->steps_per_second = executed / elapsed.count();
+                }
+                if (options.on_progress) {
+                    options.on_progress(RunProgress{
+                        .steps_done = done,
+                        .steps_requested = steps,
+                        .steps_per_second = shared->steps_per_second,
+                    });
+                }
+                if (stop_event().reason != StopReason::NONE) {
+                    return RunResult::STOPPED;
+                }
+            }
+            return RunResult::COMPLETED;
+        }).share();
+    return handle;
+}
+} // namespace day25
@@ -0,0 +1,69 @@
+#include "static_executor.hpp"
+#include <cctype>
+#include <map>
+
+using std::endl;
+using std::map;
+using std::ostream;
+using std::string;
+
+namespace day25 {
+void generate_static_spec(ostream &os, const Program &program,
+                          const string &name) {
+    auto identifier = name;
+    for (auto &c : identifier) {
+        if (!isalnum((unsigned char)c)) {
+            c = '_';
+        }
+    }
+    if (identifier.empty() || isdigit((unsigned char)identifier[0])) {
+        identifier = "_" + identifier;
+    }
+
+    map<string, unsigned> indexes;
+    for (auto &state : program.states) {
+        indexes[state.first] = indexes.size();
+    }
+
+    os << "// Generated from the program embedded as static:" << name << "."
+       << endl
+       << "#pragma once" << endl
+       << "#include \"static_executor.hpp\"" << endl
+       << endl
+       << "namespace day25 {" << endl
+       << "namespace embedded {" << endl
+       << "struct " << identifier << " {" << endl
+       << "    static constexpr const char *name = \"" << name << "\";"
+       << endl
+       << "    static constexpr uint32_t STATE_COUNT = "
+       << program.states.size() << ";" << endl
+       << "    static constexpr uint32_t INITIAL_STATE = "
+       << indexes.at(program.initial_state) << ";" << endl
+       << "    static constexpr const char *state_names[STATE_COUNT] = {"
+       << endl;
+    for (auto &state : program.states) {
+        os << "        \"" << state.first << "\"," << endl;
+    }
+    os << "    };" << endl
+       << "    static constexpr StaticAction actions[STATE_COUNT][2] = {"
+       << endl;
+    for (auto &state : program.states) {
+        os << "        {";
+        for (unsigned slot = 0; slot <= 1; slot++) {
+            auto &action = state.second.actions.at(slot);
+            os << (slot ? ", " : "") << "{" << action.write_value << ", "
+               << action.move_direction << ", "
+               << indexes.at(action.next_state) << "}";
+        }
+        os << "}," << endl;
+    }
+    os << "    };" << endl
+       << "};" << endl
+       << endl
+       << "inline const bool " << identifier
+       << "_registered = register_static_executor<" << identifier << ">();"
+       << endl
+       << "} // namespace embedded" << endl
+       << "} // namespace day25" << endl;
+}
+} // namespace day25
@@ -0,0 +1,144 @@
+#include "tape_memory.hpp"
+#include <algorithm>
+#include <cstring>
+#include <fcntl.h>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <vector>
+
+using std::runtime_error;
+
+namespace day25 {
+TapeMemory::TapeMemory(uint64_t size, const std::string &filename,
+                       TapeAdvice advice, const PagePolicy &pages)
+    : m_data(nullptr), m_size(size), m_mapped(size ? size : 1), m_huge(false),
+      m_want_huge(false), m_fd(-1), m_advice(advice), m_pages(pages) {
+    if (filename.empty()) {
+        auto mapping = map_pages(m_size, m_pages, PROT_READ | PROT_WRITE);
+        m_data = (uint8_t *)mapping.address;
+        m_mapped = mapping.size;
+        m_huge = mapping.huge;
+        m_want_huge = m_pages.huge_pages == HugePages::EXPLICIT &&
+                      (m_huge || m_size < HUGE_PAGE_SIZE);
+        advise();
+        return;
+    }
+
+    m_fd = open(filename.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (m_fd < 0) {
+        throw runtime_error("Could not open tape file " + filename);
+    }
+    // Extending an empty file leaves a hole that takes no disk space until
+    // written to.
+    if (ftruncate(m_fd, m_size)) {
+        close(m_fd);
+        throw runtime_error("Could not resize tape file " + filename);
+    }
+    auto mapped =
+        mmap(nullptr, m_mapped, PROT_READ | PROT_WRITE, MAP_SHARED, m_fd, 0);
+    if (mapped == MAP_FAILED) {
+        close(m_fd);
+        throw runtime_error("Could not map tape memory.");
+    }
+    m_data = (uint8_t *)mapped;
+    advise();
+}
+
+TapeMemory::~TapeMemory() {
+    munmap(m_data, m_mapped);
+    if (m_fd >= 0) {
+        close(m_fd);
+    }
+}
+
+void TapeMemory::resize(uint64_t size) {
+    if (m_huge || (m_want_huge && size >= HUGE_PAGE_SIZE)) {
+        resize_huge(size);
+        return;
+    }
+    if (size < m_size) {
+        // The rest of the last page stays mapped, make sure it reads as zero
+        // when growing again. At size 0, the first page stays mapped, too.
+        uint64_t page_size = sysconf(_SC_PAGESIZE);
+        uint64_t page_end = (size + page_size - 1) / page_size * page_size;
+        page_end = std::max(page_end, page_size);
+        memset(m_data + size, 0, std::min(page_end, m_size) - size);
+    }
+    if (m_fd >= 0 && ftruncate(m_fd, size)) {
+        throw runtime_error("Could not resize tape file.");
+    }
+    // Anonymous pages added by mremap are zero, and so is the part of a file
+    // beyond its previous end.
+    auto mapped = mremap(m_data, m_mapped, size ? size : 1, MREMAP_MAYMOVE);
+    if (mapped == MAP_FAILED) {
+        throw runtime_error("Could not resize tape memory.");
+    }
+    m_data = (uint8_t *)mapped;
+    m_size = size;
+    m_mapped = size ? size : 1;
+    if (m_fd < 0) {
+        // Pages mremap added do not inherit the policy of the old mapping.
+        apply_page_policy(m_data, m_mapped, m_pages);
+    }
+    advise();
+}
+
+void TapeMemory::resize_huge(uint64_t size) {
+    if (m_huge && size <= m_mapped) {
+        // Whole huge pages stay mapped; the bytes beyond the new size must read
+        // as zero when growing again.
+        if (size < m_size) {
+            memset(m_data + size, 0, m_size - size);
+        }
+        m_size = size;
+        return;
+    }
+    // Growing tapes start out below the huge page size, and mremap cannot
+    // switch page sizes or reliably grow huge page mappings; copy instead.
+    auto mapping = map_pages(size, m_pages, PROT_READ | PROT_WRITE);
+    memcpy(mapping.address, m_data, m_size);
+    munmap(m_data, m_mapped);
+    m_data = (uint8_t *)mapping.address;
+    m_size = size;
+    m_mapped = mapping.size;
+    m_huge = mapping.huge;
+    // Without huge pages, mremap avoids copying on later resizes.
+    m_want_huge = m_huge;
+    advise();
+}
+
+void TapeMemory::advise() {
+    if (m_advice == TapeAdvice::SEQUENTIAL) {
+        madvise(m_data, m_size, MADV_SEQUENTIAL);
+    } else if (m_advice == TapeAdvice::RANDOM) {
+        madvise(m_data, m_size, MADV_RANDOM);
+    }
+}
+
+uint64_t TapeMemory::resident_size() const {
+    uint64_t page_size = sysconf(_SC_PAGESIZE);
+    std::vector<unsigned char> pages((m_mapped + page_size - 1) / page_size);
+    if (mincore(m_data, m_mapped, pages.data())) {
+        return 0;
+    }
+    uint64_t resident = 0;
+    for (auto page : pages) {
+        resident += page & 1;
+    }
+    return resident * page_size;
+}
+
+void TapeMemory::clear() {
+    if (m_fd >= 0) {
+        // Writing zeroes would allocate every block of the file. Truncating
+        // and re-extending punches a hole instead; the shared mapping stays
+        // valid and reads back as zero.
+        if (ftruncate(m_fd, 0) || ftruncate(m_fd, m_size)) {
+            throw runtime_error("Could not clear tape file.");
+        }
+    } else {
+        memset(m_data, 0, m_size);
+    }
+}
+} // namespace day25
@@ -0,0 +1,178 @@
+#include "telemetry.hpp"
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <poll.h>
+#include <sstream>
+#include <stdexcept>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+using std::endl;
+using std::runtime_error;
+using std::string;
+
+namespace day25 {
+namespace {
+typedef std::chrono::steady_clock Clock;
+
+//! How often the sampling thread checks for clients and for shutdown.
+const int POLL_MILLISECONDS = 100;
+
+uint64_t resident_set_size() {
+    std::ifstream statm("/proc/self/statm");
+    uint64_t pages = 0, resident = 0;
+    if (!(statm >> pages >> resident)) {
+        return 0;
+    }
+    return resident * sysconf(_SC_PAGESIZE);
+}
+
+void write_metric(std::ostream &os, const string &name, const string &type,
+                  const string &help, const string &labels, double value) {
+    os << "# HELP day25_" << name << " " << help << endl
+       << "# TYPE day25_" << name << " " << type << endl
+       << "day25_" << name << labels << " " << value << endl;
+}
+} // namespace
+
+Telemetry::Telemetry(const Program &program, const TelemetryOptions &options)
+    : m_options(options), m_socket(-1) {
+    for (auto &state : program.states) {
+        m_state_indexes[state.first] = m_state_names.size();
+        m_state_names.push_back(state.first);
+    }
+    m_state = m_state_indexes.at(program.initial_state);
+
+    if (!options.socket_path.empty()) {
+        sockaddr_un address{};
+        address.sun_family = AF_UNIX;
+        if (options.socket_path.size() >= sizeof(address.sun_path)) {
+            throw runtime_error("Socket path too long: " + options.socket_path);
+        }
+        strcpy(address.sun_path, options.socket_path.c_str());
+        m_socket = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        unlink(options.socket_path.c_str());
+        if (m_socket < 0 ||
+            bind(m_socket, (sockaddr *)&address, sizeof(address)) ||
+            listen(m_socket, 4)) {
+            if (m_socket >= 0) {
+                close(m_socket);
+            }
+            throw runtime_error("Could not listen on " + options.socket_path);
+        }
+    }
+    m_thread = std::thread([this] { sample_loop(); });
+}
+
+Telemetry::~Telemetry() {
+    m_stopping = true;
+    m_thread.join();
+    if (!m_options.stats_file.empty()) {
+        write_stats_file();
+    }
+    if (m_socket >= 0) {
+        close(m_socket);
+        unlink(m_options.socket_path.c_str());
+    }
+}
+
+void Telemetry::publish(const Executor &executor, const RunProgress &progress) {
+    auto state = m_state_indexes.find(executor.state());
+    if (state != m_state_indexes.end()) {
+        m_state.store(state->second, std::memory_order_relaxed);
+    }
+    m_head.store(executor.head(), std::memory_order_relaxed);
+    m_tape_size.store(executor.tape_size(), std::memory_order_relaxed);
+    m_steps_per_second.store(progress.steps_per_second,
+                             std::memory_order_relaxed);
+    m_steps.store(executor.steps_executed(), std::memory_order_relaxed);
+}
+
+string Telemetry::render() const {
+    std::ostringstream os;
+    os.precision(17);
+    write_metric(os, "steps_executed", "counter",
+                 "Steps executed since the start of the run.", "",
+                 m_steps.load(std::memory_order_relaxed));
+    write_metric(os, "steps_per_second", "gauge",
+                 "Throughput over the most recent block of steps.", "",
+                 m_steps_per_second.load(std::memory_order_relaxed));
+    write_metric(os, "state", "gauge", "Current state of the machine.",
+                 "{state=\"" +
+                     m_state_names[m_state.load(std::memory_order_relaxed)] +
+                     "\"}",
+                 1);
+    write_metric(os, "head_position", "gauge",
+                 "Index of the current tape slot.", "",
+                 m_head.load(std::memory_order_relaxed));
+    write_metric(os, "tape_slots", "gauge",
+                 "Tape slots allocated, i.e. the extent the head visited.", "",
+                 m_tape_size.load(std::memory_order_relaxed));
+    write_metric(os, "resident_memory_bytes", "gauge",
+                 "Resident set size of the process.", "",
+                 resident_set_size());
+    return os.str();
+}
+
+void Telemetry::sample_loop() {
+    auto next_write = Clock::now();
+    while (!m_stopping) {
+        if (!m_options.stats_file.empty() && Clock::now() >= next_write) {
+            write_stats_file();
+            next_write += m_options.interval;
+        }
+        pollfd listener{m_socket, POLLIN, 0};
+        if (poll(&listener, m_socket >= 0 ? 1 : 0, POLL_MILLISECONDS) > 0) {
+            serve_client();
+        }
+    }
+}
+
+void Telemetry::write_stats_file() const {
+    // Replace the file in one step, so readers never see a partial sample.
+    auto tmp_name = m_options.stats_file + ".tmp";
+    {
+        std::ofstream ofs(tmp_name, std::ios::trunc);
+        ofs << render();
+        if (ofs.fail()) {
+            return;
+        }
+    }
+    std::rename(tmp_name.c_str(), m_options.stats_file.c_str());
+}
+
+void Telemetry::serve_client() const {
+    int client = accept4(m_socket, nullptr, nullptr, SOCK_CLOEXEC);
+    if (client < 0) {
+        return;
+    }
+    // The request itself does not matter: every path returns the metrics.
+    // Read what has arrived so far, so closing does not reset the connection.
+    pollfd request{client, POLLIN, 0};
+    if (poll(&request, 1, POLL_MILLISECONDS) > 0) {
+        char buffer[4096];
+        (void)!read(client, buffer, sizeof(buffer));
+    }
+    auto body = render();
+    std::ostringstream response;
+    response << "HTTP/1.0 200 OK\r\n"
+             << "Content-Type: text/plain; version=0.0.4\r\n"
+             << "Content-Length: " << body.size() << "\r\n"
+             << "\r\n"
+             << body;
+    auto text = response.str();
+    const char *data = text.data();
+    auto remaining = text.size();
+    while (remaining > 0) {
+        auto written = send(client, data, remaining, MSG_NOSIGNAL);
+        if (written <= 0) {
+            break;
+        }
+        data += written;
+        remaining -= written;
+    }
+    close(client);
+}
+} // namespace day25
@@ -0,0 +1,147 @@
+#include "tiered_executor.hpp"
+#include <algorithm>
+#include <stdexcept>
+
+namespace day25 {
+namespace {
+//! Steps the bytecode tier runs before checking whether the JIT is ready.
+const uint64_t PROMOTION_CHECK_INTERVAL = 1 << 20;
+} // namespace
+
+TieredProgram::TieredProgram(Program program, const PagePolicy &pages)
+    : CompiledProgram(program),
+      m_bytecode(std::make_shared<BytecodeProgram>(program)),
+      m_jit_ready(false) {
+    m_jit = std::async(std::launch::async,
+                       [this, pages] {
+                           std::shared_ptr<const JitProgram> jit;
+                           try {
+                               jit = std::make_shared<JitProgram>(
+                                   this->program(), nullptr, pages);
+                           } catch (std::exception &) {
+                               // Stay in the bytecode tier.
+                           }
+                           m_jit_ready = true;
+                           return jit;
+                       })
+                .share();
+}
+
+TieredProgram::~TieredProgram() { m_jit.wait(); }
+
+std::shared_ptr<Executor>
+TieredProgram::instantiate(const ExecutorOptions &options) const {
+    if (options.observer) {
+        throw std::runtime_error("The tiered executor does not support observers.");
+    }
+    if (options.stop.active()) {
+        throw std::runtime_error(
+            "The tiered executor does not support stop conditions.");
+    }
+    return std::make_shared<TieredExecutor>(
+        std::static_pointer_cast<const TieredProgram>(shared_from_this()),
+        options);
+}
+
+std::shared_ptr<const JitProgram> TieredProgram::jit() const {
+    if (!jit_ready()) {
+        return nullptr;
+    }
+    return m_jit.get();
+}
+
+MemoryUsage TieredProgram::memory_usage() const {
+    auto usage = m_bytecode->memory_usage();
+    if (auto compiled = jit()) {
+        usage += compiled->memory_usage();
+    }
+    return usage;
+}
+
+TieredExecutor::TieredExecutor(Program program,
+                               const ExecutorOptions &options)
+    : TieredExecutor(std::make_shared<TieredProgram>(program), options) {}
+
+TieredExecutor::TieredExecutor(std::shared_ptr<const TieredProgram> compiled,
+                               const ExecutorOptions &options)
+    : m_compiled(compiled), m_options(options), m_promotable(true) {
+    m_interpreter.reset(new BytecodeExecutor(compiled->bytecode(), options));
+    m_active = m_interpreter.get();
+}
+
+TieredExecutor::~TieredExecutor() {}
+
+void TieredExecutor::try_promote() {
+    if (!m_promotable || !m_compiled->jit_ready()) {
+        return;
+    }
+    auto compiled = m_compiled->jit();
+    if (!compiled) {
+        m_promotable = false;
+        return;
+    }
+    // Opening a tape file truncates it, so the interpreter has to let go of
+    // it first.
+    auto snapshot = m_interpreter->machine_state();
+    m_interpreter.reset();
+    m_jit.reset(new JitExecutor(compiled, m_options));
+    m_jit->restore_machine_state(snapshot);
+    m_active = m_jit.get();
+}
+
+void TieredExecutor::step() {
+    if (!m_jit) {
+        try_promote();
+    }
+    m_active->step();
+    m_steps = m_active->steps_executed();
+}
+
+void TieredExecutor::run(uint64_t steps) {
+    while (steps && !m_jit) {
+        try_promote();
+        if (m_jit) {
+            break;
+        }
+        auto block = std::min(steps, PROMOTION_CHECK_INTERVAL);
+        m_active->run(block);
+        steps -= block;
+    }
+    m_active->run(steps);
+    m_steps = m_active->steps_executed();
+}
+
+void TieredExecutor::reset() {
+    m_active->reset();
+    m_steps = 0;
+}
+
+uint64_t TieredExecutor::diagnostic_checksum() {
+    return m_active->diagnostic_checksum();
+}
+
+uint64_t TieredExecutor::head() const { return m_active->head(); }
+
+uint64_t TieredExecutor::tape_size() const { return m_active->tape_size(); }
+
+MemoryUsage TieredExecutor::memory_usage(bool measure_touched) const {
+    // Only the tape of the active tier is counted; the other one is gone.
+    auto usage = m_compiled->memory_usage();
+    auto active = m_active->memory_usage(measure_touched);
+    usage.tape_reserved = active.tape_reserved;
+    usage.tape_touched = active.tape_touched;
+    usage.tape_maximum = active.tape_maximum;
+    return usage;
+}
+
+std::string TieredExecutor::state() const { return m_active->state(); }
+
+MachineState TieredExecutor::machine_state() const {
+    return m_active->machine_state();
+}
+
+void TieredExecutor::restore_machine_state(const MachineState &state) {
+    m_active->restore_machine_state(state);
+    m_steps = m_active->steps_executed();
+}
+} // namespace day25
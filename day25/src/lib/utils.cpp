@@ -3,24 +3,38 @@
 #include "tokenizer.hpp"
 #include <fstream>
 #include <regex>
+#include <sstream>
 
 using std::ifstream;
+using std::istream;
+using std::istringstream;
 using std::string;
+using std::to_string;
 
 namespace day25 {
-Program load_file(const std::string &filename) {
-    ifstream ifs(filename);
-    if (ifs.fail() || ifs.bad()) {
-        throw new std::runtime_error("Could not open file " + filename);
-    }
-    Tokenizer t(ifs);
+Program parse_program(istream &source, const string &name) {
+    Tokenizer t(source);
     Parser p(t);
     auto state = p.parse();
     if (state.error) {
-        string msg = "Error trying to compile program " + filename + "\n";
-        // msg += state.
-        throw new std::runtime_error(msg);
+        string msg = "Error trying to compile program " + name + "\n";
+        msg += "Line " + to_string(state.token.line_number) + ": " +
+               state.error_message;
+        throw std::runtime_error(msg);
     }
     return p.program();
 }
-} // namespace day25
\ No newline at end of file
+
+Program load_file(const std::string &filename) {
+    ifstream ifs(filename);
+    if (ifs.fail() || ifs.bad()) {
+        throw std::runtime_error("Could not open file " + filename);
+    }
+    return parse_program(ifs, filename);
+}
+
+Program load_string(const std::string &source) {
+    istringstream iss(source);
+    return parse_program(iss, "<string>");
+}
+} // namespace day25